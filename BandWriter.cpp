@@ -0,0 +1,85 @@
+#include "BandWriter.h"
+#include "Trace.h"
+
+#include <QIODevice>
+#include <QRunnable>
+#include <functional>
+
+namespace {
+
+class WriterTask : public QRunnable {
+public:
+    explicit WriterTask(std::function<void()> function) : function(std::move(function)) {}
+    void run() override { function(); }
+
+private:
+    std::function<void()> function;
+};
+
+} // namespace
+
+BandWriter::BandWriter(QIODevice &device, qint64 bandBytes, bool pipelined)
+    : device(device), pipelined(pipelined), sizes{0, 0}, current(0),
+      freeBuffers(pipelined ? 2 : 1), failed(false), finished(false) {
+    buffers[0] = QByteArray(static_cast<int>(bandBytes), 0);
+    if (pipelined) {
+        buffers[1] = QByteArray(static_cast<int>(bandBytes), 0);
+        writerPool.setMaxThreadCount(1);
+        writerPool.start(new WriterTask([this]() { writeBands(); }));
+    }
+}
+
+BandWriter::~BandWriter() {
+    finish();
+}
+
+uchar *BandWriter::nextBuffer() {
+    freeBuffers.acquire();
+    return reinterpret_cast<uchar*>(buffers[current].data());
+}
+
+void BandWriter::submit(qint64 bytes) {
+    if (!pipelined) {
+        BMP_TRACE_SCOPE("write band");
+        if (!failed && device.write(buffers[0].constData(), bytes) != bytes) {
+            failed = true;
+        }
+        freeBuffers.release();
+        return;
+    }
+    sizes[current] = bytes;
+    filledBuffers.release();
+    current ^= 1;
+}
+
+bool BandWriter::finish() {
+    if (!finished) {
+        finished = true;
+        if (pipelined) {
+            // Záporná délka ukončí zapisující vlákno
+            freeBuffers.acquire();
+            sizes[current] = -1;
+            filledBuffers.release();
+            writerPool.waitForDone();
+        }
+    }
+    return !failed;
+}
+
+void BandWriter::writeBands() {
+    for (int index = 0; ; index ^= 1) {
+        filledBuffers.acquire();
+        const qint64 bytes = sizes[index];
+        if (bytes < 0) {
+            return;
+        }
+        // Po chybě se zbylé pásy jen uvolňují, aby volající nečekal
+        if (!failed) {
+            BMP_TRACE_SCOPE("write band");
+            if (device.write(buffers[index].constData(), bytes) != bytes) {
+                failed = true;
+            }
+        }
+        freeBuffers.release();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef BANDWRITER_H
+#define BANDWRITER_H
+
+#include <QByteArray>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <atomic>
+
+class QIODevice;
+
+// Zápis dat po pásech s dvojitou vyrovnávací pamětí: zatímco samostatné
+// vlákno zapisuje jeden pás do zařízení, volající už plní druhý. Paměť navíc
+// jsou jen dva pásy. Pro jediný pás se zapisuje rovnou ve volajícím vlákně.
+class BandWriter {
+public:
+    BandWriter(QIODevice &device, qint64 bandBytes, bool pipelined);
+    ~BandWriter();
+    BandWriter(const BandWriter&) = delete;
+    BandWriter& operator=(const BandWriter&) = delete;
+
+    // Volný pás pro další data (počká, dokud se z něj nedopíše předchozí pás).
+    // Každé volání musí následovat submit().
+    uchar *nextBuffer();
+    // Předá vyplněných 'bytes' bajtů z pásu k zápisu
+    void submit(qint64 bytes);
+    // Počká na zápis všech pásů; false, pokud některý zápis selhal
+    bool finish();
+
+private:
+    QIODevice &device;
+    const bool pipelined;
+    QByteArray buffers[2];
+    qint64 sizes[2];
+    int current;  // Pás, který plní volající
+    QSemaphore freeBuffers;
+    QSemaphore filledBuffers;
+    std::atomic<bool> failed;
+    bool finished;
+    QThreadPool writerPool;
+
+    void writeBands();
+};
+
+#endif // BANDWRITER_H
@@ -0,0 +1,237 @@
+#include "BatchProcessor.h"
+#include "Image.h"
+#include "ParallelRows.h"
+#include "WorkStealingPool.h"
+#include "Filters/FilterPipeline.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+class IoTask : public QRunnable {
+public:
+    explicit IoTask(std::function<void()> task) : task(std::move(task)) {}
+    void run() override { task(); }
+
+private:
+    std::function<void()> task;
+};
+
+// Jeden soubor na cestě mezi fázemi
+struct FileJob {
+    BatchProcessor::Item item;
+    QByteArray data;  // Obsah vstupního, později výstupního souboru
+    qint64 stageNs[BatchProcessor::StageCount] = {};
+    qint64 inputBytes = 0;
+    QElapsedTimer totalTimer;
+};
+
+// Stav jednoho běhu - fáze si soubory předávají mezi I/O vlákny a výpočetním poolem
+class BatchRun {
+public:
+    BatchRun(const FilterPipeline &pipeline, const BatchProcessor::Options &options)
+        : pipeline(pipeline), rleCompression(options.rleCompression), computePool(options.computeThreads),
+          maxInFlight(options.maxFilesInFlight > 0 ? options.maxFilesInFlight : 2 * computePool.threadCount()),
+          inFlight(maxInFlight) {
+        ioPool.setMaxThreadCount(qMax(1, options.ioThreads));
+    }
+
+    BatchProcessor::Stats run(const QVector<BatchProcessor::Item> &items) {
+        QElapsedTimer wallTimer;
+        wallTimer.start();
+
+        // Čtení dalšího souboru začne, až se uvolní místo - paměť drží jen
+        // omezený počet rozpracovaných souborů
+        for (const BatchProcessor::Item &item : items) {
+            inFlight.acquire();
+            auto job = std::make_shared<FileJob>();
+            job->item = item;
+            ioPool.start(new IoTask([this, job]() { read(job); }));
+        }
+
+        inFlight.acquire(maxInFlight);
+        inFlight.release(maxInFlight);
+        computePool.waitForDone();
+        ioPool.waitForDone();
+
+        stats.elapsedNs = wallTimer.nsecsElapsed();
+        stats.stolenTasks = computePool.stolenTasks();
+        return stats;
+    }
+
+private:
+    const FilterPipeline &pipeline;
+    const bool rleCompression;
+    WorkStealingPool computePool;
+    QThreadPool ioPool;
+    const int maxInFlight;
+    QSemaphore inFlight;
+
+    QMutex statsMutex;
+    BatchProcessor::Stats stats;
+
+    void read(const std::shared_ptr<FileJob> &job) {
+        job->totalTimer.start();
+        QElapsedTimer timer;
+        timer.start();
+
+        QFile file(job->item.inputPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fail(job, QString("Nelze otevřít soubor %1").arg(job->item.inputPath));
+            return;
+        }
+        job->data = file.readAll();
+        job->inputBytes = job->data.size();
+        job->stageNs[BatchProcessor::Read] = timer.nsecsElapsed();
+
+        computePool.submit([this, job]() { process(job); });
+    }
+
+    void process(const std::shared_ptr<FileJob> &job) {
+        // Paralelizuje se po souborech - řádky jednoho souboru zpracuje jedno vlákno
+        ParallelRows::SerialScope serial;
+        QElapsedTimer timer;
+        timer.start();
+
+        // Dávka se nevrací zpět - historie by jen držela snímky
+        Image image;
+        image.setUndoBudget(0);
+        bool loaded = image.loadFromData(std::move(job->data));
+        job->data = QByteArray();
+        if (!loaded) {
+            fail(job, QString("Soubor %1 není podporovaný BMP").arg(job->item.inputPath));
+            return;
+        }
+        job->stageNs[BatchProcessor::Decode] = timer.nsecsElapsed();
+
+        timer.restart();
+        if (!pipeline.isEmpty()) {
+            image.applyFilter(pipeline);
+        }
+        job->stageNs[BatchProcessor::Filter] = timer.nsecsElapsed();
+
+        timer.restart();
+        if (rleCompression) {
+            image.setSaveCompression(Image::Compression::RleIfSmaller);
+        }
+        if (!image.saveToData(job->data)) {
+            fail(job, QString("Soubor %1 nelze zakódovat").arg(job->item.inputPath));
+            return;
+        }
+        job->stageNs[BatchProcessor::Encode] = timer.nsecsElapsed();
+
+        ioPool.start(new IoTask([this, job]() { write(job); }));
+    }
+
+    void write(const std::shared_ptr<FileJob> &job) {
+        QElapsedTimer timer;
+        timer.start();
+
+        QDir().mkpath(QFileInfo(job->item.outputPath).absolutePath());
+        // Výstup se objeví až celý (dočasný soubor se po zápisu přejmenuje)
+        QSaveFile file(job->item.outputPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(job->data) != job->data.size() || !file.commit()) {
+            fail(job, QString("Nelze zapsat soubor %1").arg(job->item.outputPath));
+            return;
+        }
+        job->stageNs[BatchProcessor::Write] = timer.nsecsElapsed();
+        job->stageNs[BatchProcessor::Total] = job->totalTimer.nsecsElapsed();
+
+        {
+            QMutexLocker locker(&statsMutex);
+            stats.processedFiles++;
+            stats.bytesRead += job->inputBytes;
+            stats.bytesWritten += job->data.size();
+            for (int stage = 0; stage < BatchProcessor::StageCount; stage++) {
+                stats.stageNs[stage].append(job->stageNs[stage]);
+            }
+        }
+        inFlight.release();
+    }
+
+    void fail(const std::shared_ptr<FileJob> &job, const QString &message) {
+        {
+            QMutexLocker locker(&statsMutex);
+            stats.failedFiles++;
+            stats.bytesRead += job->inputBytes;
+            stats.errors.append(message);
+        }
+        inFlight.release();
+    }
+};
+
+} // namespace
+
+BatchProcessor::BatchProcessor(const FilterPipeline &pipeline, const Options &options)
+    : pipeline(pipeline), options(options) {}
+
+BatchProcessor::Stats BatchProcessor::run(const QVector<Item> &items) {
+    BatchRun batch(pipeline, options);
+    return batch.run(items);
+}
+
+QStringList BatchProcessor::collectFiles(const QString &input, bool recursive) {
+    // Adresář se prochází celý, jinak je poslední část cesty maska souborů
+    QFileInfo inputInfo(input);
+    QString root = inputInfo.isDir() ? inputInfo.absoluteFilePath() : inputInfo.absolutePath();
+    QStringList nameFilters = inputInfo.isDir() ? QStringList("*.bmp") : QStringList(inputInfo.fileName());
+
+    QStringList paths;
+    QDirIterator it(root, nameFilters, QDir::Files | QDir::Readable,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        paths.append(it.next());
+    }
+    paths.sort();
+    return paths;
+}
+
+QVector<BatchProcessor::Item> BatchProcessor::collectItems(const QString &input, const QString &outputDirectory,
+                                                           bool recursive) {
+    QFileInfo inputInfo(input);
+    QString root = inputInfo.isDir() ? inputInfo.absoluteFilePath() : inputInfo.absolutePath();
+    const QStringList paths = collectFiles(input, recursive);
+
+    QDir rootDir(root);
+    QDir outputDir(outputDirectory);
+    QVector<Item> items;
+    items.reserve(paths.size());
+    for (const QString &path : paths) {
+        items.append({path, outputDir.filePath(rootDir.relativeFilePath(path))});
+    }
+    return items;
+}
+
+QString BatchProcessor::stageName(Stage stage) {
+    switch (stage) {
+        case Read: return "čtení";
+        case Decode: return "dekódování";
+        case Filter: return "filtry";
+        case Encode: return "kódování";
+        case Write: return "zápis";
+        default: return "celkem";
+    }
+}
+
+qint64 BatchProcessor::percentile(QVector<qint64> samples, double fraction) {
+    if (samples.isEmpty()) {
+        return 0;
+    }
+    // Nejbližší pořadí (nearest-rank) - vrací vždy některý z naměřených vzorků
+    int rank = static_cast<int>(std::ceil(qBound(0.0, fraction, 1.0) * samples.size()));
+    int index = qBound(0, rank - 1, samples.size() - 1);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
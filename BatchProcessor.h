@@ -0,0 +1,59 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class FilterPipeline;
+
+// Dávkové zpracování mnoha BMP souborů bez GUI. Každý soubor projde fázemi
+// čtení -> dekódování -> filtry -> kódování -> zápis. Čtení a zápis běží na
+// samostatných I/O vláknech, výpočetní fáze na WorkStealingPool, takže se
+// práce s diskem překrývá s výpočtem. Počet rozpracovaných souborů je omezený,
+// aby paměť nerostla s počtem souborů.
+class BatchProcessor {
+public:
+    enum Stage { Read, Decode, Filter, Encode, Write, Total, StageCount };
+
+    struct Options {
+        int computeThreads = 0;   // 0 = počet jader procesoru
+        int ioThreads = 2;
+        int maxFilesInFlight = 0; // 0 = dvojnásobek výpočetních vláken
+        bool rleCompression = false; // Ukládat 4/8bitové obrázky s RLE (jinak podle vstupu)
+    };
+
+    struct Item {
+        QString inputPath;
+        QString outputPath;
+    };
+
+    struct Stats {
+        int processedFiles = 0;
+        int failedFiles = 0;
+        qint64 bytesRead = 0;
+        qint64 bytesWritten = 0;
+        qint64 elapsedNs = 0;
+        qint64 stolenTasks = 0;
+        QVector<qint64> stageNs[StageCount];  // Doba fáze pro každý zpracovaný soubor
+        QStringList errors;
+    };
+
+    BatchProcessor(const FilterPipeline &pipeline, const Options &options);
+
+    Stats run(const QVector<Item> &items);
+
+    // Soubory *.bmp v adresáři nebo soubory odpovídající masce (např. "in/*.bmp")
+    static QStringList collectFiles(const QString &input, bool recursive);
+    // Totéž s výstupními cestami, které zachovávají umístění vůči vstupnímu adresáři
+    static QVector<Item> collectItems(const QString &input, const QString &outputDirectory, bool recursive);
+    static QString stageName(Stage stage);
+    // Hodnota, pod kterou leží daný podíl (0..1) vzorků
+    static qint64 percentile(QVector<qint64> samples, double fraction);
+
+private:
+    const FilterPipeline &pipeline;
+    Options options;
+};
+
+#endif // BATCHPROCESSOR_H
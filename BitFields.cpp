@@ -0,0 +1,84 @@
+#include "BitFields.h"
+
+#include <initializer_list>
+
+BitFields::Channel BitFields::Channel::fromMask(quint32 mask) {
+    Channel channel = {mask, 0, 0};
+    if (mask == 0) {
+        return channel;
+    }
+    while (((mask >> channel.shift) & 1) == 0) {
+        channel.shift++;
+    }
+    while (channel.shift + channel.bits < 32 && ((mask >> (channel.shift + channel.bits)) & 1) != 0) {
+        channel.bits++;
+    }
+    return channel;
+}
+
+int BitFields::Channel::read(quint32 pixel) const {
+    if (bits == 0) {
+        return 0;
+    }
+    // Hodnota se roztáhne na celý rozsah 0-255 (např. 5 bitů: 31 -> 255)
+    const quint64 maximum = (quint64(1) << bits) - 1;
+    const quint64 value = (pixel & mask) >> shift;
+    return static_cast<int>((value * 255 + maximum / 2) / maximum);
+}
+
+quint32 BitFields::Channel::write(int value) const {
+    if (bits == 0) {
+        return 0;
+    }
+    const quint64 maximum = (quint64(1) << bits) - 1;
+    return static_cast<quint32>(((quint64(value) * maximum + 127) / 255) << shift) & mask;
+}
+
+BitFields BitFields::defaults(int bitsPerPixel) {
+    switch (bitsPerPixel) {
+        case 16: return {0x7c00, 0x03e0, 0x001f, 0};
+        case 32: return {0x00ff0000, 0x0000ff00, 0x000000ff, 0};
+        default: return {0, 0, 0, 0};
+    }
+}
+
+bool BitFields::isValid(int bitsPerPixel) const {
+    if (bitsPerPixel != 16 && bitsPerPixel != 32) {
+        return false;
+    }
+    if (red == 0 || green == 0 || blue == 0) {
+        return false;
+    }
+    if ((red & green) || (red & blue) || (green & blue) || ((red | green | blue) & alpha)) {
+        return false;
+    }
+    if (bitsPerPixel == 16 && ((red | green | blue | alpha) & 0xffff0000u)) {
+        return false;
+    }
+
+    // Obecný převod počítá s posunem a šířkou - maska nesmí mít mezery
+    for (quint32 mask : {red, green, blue, alpha}) {
+        const Channel channel = Channel::fromMask(mask);
+        const quint64 bits = channel.bits == 0 ? 0 : ((quint64(1) << channel.bits) - 1) << channel.shift;
+        if (bits != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BitFields::Layout BitFields::layout(int bitsPerPixel) const {
+    if (bitsPerPixel == 16 && blue == 0x001f && alpha == 0) {
+        if (red == 0x7c00 && green == 0x03e0) return Rgb555;
+        if (red == 0xf800 && green == 0x07e0) return Rgb565;
+    }
+    if (bitsPerPixel == 32 && red == 0x00ff0000 && green == 0x0000ff00 && blue == 0x000000ff) {
+        if (alpha == 0) return Xrgb8888;
+        if (alpha == 0xff000000u) return Argb8888;
+    }
+    return Generic;
+}
+
+bool BitFields::operator==(const BitFields &other) const {
+    return red == other.red && green == other.green && blue == other.blue && alpha == other.alpha;
+}
@@ -0,0 +1,44 @@
+#ifndef BITFIELDS_H
+#define BITFIELDS_H
+
+#include <QtGlobal>
+
+// Masky barevných kanálů 16 a 32bitových BMP (BI_BITFIELDS, hlavičky V4/V5).
+// BI_RGB odpovídá pevným maskám X1R5G5B5 (16 bitů) a X8R8G8B8 (32 bitů).
+struct BitFields {
+    // Hodnoty biCompression
+    static const quint32 Bitfields = 3;
+    static const quint32 AlphaBitfields = 6;
+
+    // Běžná rozložení mají vlastní kernely, ostatní masky obecný převod
+    enum Layout { Rgb555, Rgb565, Xrgb8888, Argb8888, Generic };
+
+    // Jeden kanál: poloha a šířka masky, převod z/do 8 bitů
+    struct Channel {
+        quint32 mask;
+        int shift;
+        int bits;
+
+        static Channel fromMask(quint32 mask);
+        int read(quint32 pixel) const;      // 0-255
+        quint32 write(int value) const;     // z 0-255
+    };
+
+    quint32 red;
+    quint32 green;
+    quint32 blue;
+    quint32 alpha;
+
+    // Masky BI_RGB (pro jiné hloubky než 16 a 32 bitů nulové)
+    static BitFields defaults(int bitsPerPixel);
+
+    // Barevné masky jsou nenulové, souvislé, nepřekrývají se a vejdou se do pixelu
+    bool isValid(int bitsPerPixel) const;
+    bool hasAlpha() const { return alpha != 0; }
+    Layout layout(int bitsPerPixel) const;
+
+    bool operator==(const BitFields &other) const;
+    bool operator!=(const BitFields &other) const { return !(*this == other); }
+};
+
+#endif // BITFIELDS_H
@@ -0,0 +1,142 @@
+#include "BmpStreamProcessor.h"
+#include "Image.h"
+#include "ParallelRows.h"
+#include "RleCodec.h"
+#include "RowDecoder.h"
+#include "RowEncoder.h"
+#include "Filters/Filter.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+BmpStreamProcessor::BmpStreamProcessor(qint64 chunkBytes) : chunkBytes(qMax<qint64>(1, chunkBytes)) {}
+
+bool BmpStreamProcessor::process(const QString &inputPath, const QString &outputPath,
+                                 const QVector<const Filter*> &filters) {
+    error.clear();
+
+    // Proudově lze použít jen filtry, které pracují po řádcích
+    for (const Filter *filter : filters) {
+        if (!filter->isRowLocal()) {
+            return fail(QString("Filtr '%1' nelze použít při proudovém zpracování").arg(filter->name()));
+        }
+    }
+
+    QFile input(inputPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return fail(QString("Nelze otevřít soubor %1").arg(inputPath));
+    }
+
+    // Načtení a kontrola hlaviček (včetně případných masek kanálů)
+    QByteArray headerData = input.read(Image::MaxHeadersSize);
+    Image::BMPFileHeader fileHeader;
+    Image::BMPInfoHeader infoHeader;
+    if (!Image::parseHeaders(reinterpret_cast<const uchar*>(headerData.constData()), headerData.size(),
+                             fileHeader, infoHeader)) {
+        return fail("Soubor není platný BMP");
+    }
+    if (!Image::isSupported(infoHeader) || infoHeader.biWidth <= 0 || infoHeader.biHeight == 0) {
+        return fail("Nepodporovaný formát BMP");
+    }
+    if (RleCodec::isRle(infoHeader.biCompression)) {
+        // Délka RLE řádků není známá předem, nelze je číst po blocích
+        return fail("Komprimované BMP nelze zpracovat proudově");
+    }
+
+    const int width = infoHeader.biWidth;
+    const qint64 height = qAbs(static_cast<qint64>(infoHeader.biHeight));
+    const int bitsPerPixel = infoHeader.biBitCount;
+    const qint64 bytesPerRow = Image::calculateRowSize(width, bitsPerPixel);
+
+    // Načtení palety (index v datech nemůže překročit 2^bitsPerPixel)
+    QVector<QRgb> palette;
+    if (bitsPerPixel <= 8) {
+        qint64 paletteSize = (infoHeader.biClrUsed > 0) ? infoHeader.biClrUsed : (1 << bitsPerPixel);
+        paletteSize = qMin<qint64>(paletteSize, 1 << bitsPerPixel);
+        QByteArray paletteData;
+        if (input.seek(Image::paletteOffset(infoHeader))) {
+            paletteData = input.read(paletteSize * 4);
+        }
+        for (int i = 0; i < paletteSize && i*4 + 2 < paletteData.size(); i++) {
+            const uchar *entry = reinterpret_cast<const uchar*>(paletteData.constData()) + i*4;
+            palette.append(qRgb(entry[2], entry[1], entry[0]));
+        }
+    }
+
+    // Výstupní hlavičky - pixelová data následují hned za paletou. Velikosti,
+    // které se nevejdou do 32 bitů, se zapisují jako 0 (pro BI_RGB povoleno).
+    const qint64 imageBytes = bytesPerRow * height;
+    Image::BMPFileHeader outFileHeader = fileHeader;
+    Image::BMPInfoHeader outInfoHeader = infoHeader;
+    Image::prepareInfoHeader(outInfoHeader, 0);
+    outInfoHeader.biClrUsed = static_cast<quint32>(palette.size());
+    outInfoHeader.biSizeImage = imageBytes <= 0xffffffffLL ? static_cast<quint32>(imageBytes) : 0;
+    outFileHeader.bfOffBits = static_cast<quint32>(Image::paletteOffset(outInfoHeader) + palette.size() * 4);
+    qint64 fileBytes = outFileHeader.bfOffBits + imageBytes;
+    outFileHeader.bfSize = fileBytes <= 0xffffffffLL ? static_cast<quint32>(fileBytes) : 0;
+
+    // Zapisuje se do dočasného souboru, cílový ho nahradí až po úspěšném konci
+    QSaveFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly) ||
+        !Image::writeHeaders(output, outFileHeader, outInfoHeader, palette)) {
+        return fail(QString("Nelze zapsat soubor %1").arg(outputPath));
+    }
+
+    if (!input.seek(fileHeader.bfOffBits)) {
+        return fail("Chybný offset obrazových dat");
+    }
+
+    const BitFields masks = Image::channelMasks(infoHeader);
+    const RowDecoder decoder(bitsPerPixel, width, palette, masks);
+    const RowEncoder encoder(bitsPerPixel, width, palette, masks);
+
+    // Bloky řádků - paměť je omezená velikostí bloku bez ohledu na výšku obrázku
+    const qint64 chunkRows = qBound<qint64>(1, chunkBytes / bytesPerRow, height);
+    QByteArray inputChunk(static_cast<int>(chunkRows * bytesPerRow), 0);
+    QByteArray outputChunk(static_cast<int>(chunkRows * bytesPerRow), 0);
+
+    for (qint64 firstRow = 0; firstRow < height; firstRow += chunkRows) {
+        const int rows = static_cast<int>(qMin(chunkRows, height - firstRow));
+        const qint64 chunkSize = rows * bytesPerRow;
+
+        // Zkrácený soubor - chybějící pixely budou černé (stejně jako v Image)
+        const qint64 bytesRead = qMax<qint64>(0, input.read(inputChunk.data(), chunkSize));
+        const uchar *in = reinterpret_cast<const uchar*>(inputChunk.constData());
+        uchar *out = reinterpret_cast<uchar*>(outputChunk.data());
+        std::fill(out, out + chunkSize, 0);
+
+        // Pořadí řádků v souboru se zachovává, řádkové filtry na něm nezávisí
+        ParallelRows::forEachBand(rows, bytesPerRow, [&](int bandFirst, int bandEnd) {
+            QVector<QRgb> pixels(width);
+            for (int row = bandFirst; row < bandEnd; row++) {
+                qint64 offset = row * bytesPerRow;
+                qint64 available = bytesRead - offset;
+                decoder.decodeRow(available > 0 ? in + offset : nullptr, available, pixels.data());
+                for (const Filter *filter : filters) {
+                    filter->applyToRow(pixels.data(), width);
+                }
+                encoder.encodeRow(pixels.constData(), out + offset);
+            }
+        });
+
+        if (output.write(outputChunk.constData(), chunkSize) != chunkSize) {
+            return fail(QString("Zápis do souboru %1 selhal").arg(outputPath));
+        }
+    }
+
+    if (!output.commit()) {
+        return fail(QString("Zápis do souboru %1 selhal").arg(outputPath));
+    }
+    return true;
+}
+
+QString BmpStreamProcessor::errorString() const {
+    return error;
+}
+
+bool BmpStreamProcessor::fail(const QString &message) {
+    error = message;
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef BMPSTREAMPROCESSOR_H
+#define BMPSTREAMPROCESSOR_H
+
+#include <QString>
+#include <QVector>
+
+class Filter;
+
+// Proudové zpracování BMP souboru: řádky se čtou po blocích, projdou řádkovými
+// filtry (Filter::isRowLocal) a hned se zapisují do výstupního souboru.
+// Spotřeba paměti je daná velikostí bloku, ne výškou obrázku, takže lze
+// zpracovat i soubory větší než dostupná paměť.
+class BmpStreamProcessor {
+public:
+    static const qint64 DefaultChunkBytes = 8 * 1024 * 1024;
+
+    explicit BmpStreamProcessor(qint64 chunkBytes = DefaultChunkBytes);
+
+    bool process(const QString &inputPath, const QString &outputPath, const QVector<const Filter*> &filters);
+    QString errorString() const;
+
+private:
+    qint64 chunkBytes;
+    QString error;
+
+    bool fail(const QString &message);
+};
+
+#endif // BMPSTREAMPROCESSOR_H
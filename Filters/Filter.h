@@ -2,12 +2,45 @@
 #define FILTER_H
 
 #include <QImage>
+#include <memory>
+
+#include "IndexedImage.h"
+#include "PixelOps.h"
+
+class JobControl;
 
 class Filter {
 public:
     virtual ~Filter() = default;
     virtual QImage apply(const QImage& image) const = 0;
     virtual QString name() const = 0;
+
+    // Varianta pro běh mimo GUI vlákno: filtr se v průběhu ptá, zda nebyl
+    // zrušen (výsledek se pak zahodí), a hlásí průběh. Filtry, které ji
+    // nepřepíší, doběhnou celé a zrušení se projeví až po nich.
+    virtual QImage applyCancellable(const QImage& image, const JobControl& control) const {
+        Q_UNUSED(control);
+        return apply(image);
+    }
+
+    // Filtry, jejichž výsledek na řádku závisí jen na tomtéž řádku, lze
+    // použít i při proudovém zpracování souboru (bez načtení celého obrázku)
+    virtual bool isRowLocal() const { return false; }
+    virtual void applyToRow(QRgb *row, int width) const { Q_UNUSED(row); Q_UNUSED(width); }
+
+    // Filtr, který umí upravit obrázek s paletou přímo (např. jen jeho paletu),
+    // vrací true; výchozí implementace nic nedělá a vrací false
+    virtual bool applyToIndexed(IndexedImage &image) const { Q_UNUSED(image); return false; }
+
+    // Filtr, který výsledek vrátí přesně do původního stavu - historie úprav
+    // si pak nemusí pamatovat pixely. Filtr bez přesné inverze vrací nullptr.
+    virtual std::shared_ptr<const Filter> inverse() const { return nullptr; }
+
+    // Popis filtru pro FilterPipeline: čistě geometrický filtr vyplní
+    // 'orientation', filtr upravující kanály nezávisle vyplní 'lut'.
+    // Filtr, který takto popsat nelze, vrací false.
+    virtual bool describeGeometry(Orientation &orientation) const { Q_UNUSED(orientation); return false; }
+    virtual bool describeLut(ChannelLut &lut) const { Q_UNUSED(lut); return false; }
 };
 
 #endif // FILTER_H
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "FilterPipeline.h"
+#include "IndexedTransforms.h"
+#include "Rotation.h"
+#include "../JobControl.h"
+#include "../ParallelRows.h"
+
+#include <QPoint>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+// Dlaždice pro průchod, při kterém se čtou sloupce zdroje
+const int TileSize = 64;
+
+// Souřadnice zdrojového pixelu pro cílový pixel (x, y) - inverzní
+// transformace: otočení zpět a potom případné zrcadlení
+QPoint sourceOf(const Orientation &orientation, int srcWidth, int srcHeight, int x, int y) {
+    bool swapped = orientation.quarterTurns % 2 != 0;
+    int width = swapped ? srcHeight : srcWidth;
+    int height = swapped ? srcWidth : srcHeight;
+    for (int i = 0; i < orientation.quarterTurns; i++) {
+        // Otočení po směru: cíl(x, y) = zdroj(y, výška zdroje - 1 - x),
+        // výška zdroje je šířka cíle
+        int sourceX = y;
+        int sourceY = width - 1 - x;
+        x = sourceX;
+        y = sourceY;
+        std::swap(width, height);
+    }
+    if (orientation.mirrored) {
+        x = width - 1 - x;
+    }
+    return QPoint(x, y);
+}
+
+// Jeden průchod cílovým obrázkem; zdrojový pixel se najde posunem
+// o pevný krok v bajtech (transformace je afinní)
+template <bool UseLut>
+void traverse(const QImage &src, QImage &dst, const Orientation &orientation, const ChannelLut &lut,
+              const JobControl &control) {
+    const qint64 srcBytesPerLine = src.bytesPerLine();
+    QPoint origin = sourceOf(orientation, src.width(), src.height(), 0, 0);
+    QPoint stepX = sourceOf(orientation, src.width(), src.height(), 1, 0) - origin;
+    QPoint stepY = sourceOf(orientation, src.width(), src.height(), 0, 1) - origin;
+    const qint64 originBytes = origin.y() * srcBytesPerLine + origin.x() * 4;
+    const qint64 stepXBytes = stepX.y() * srcBytesPerLine + stepX.x() * 4;
+    const qint64 stepYBytes = stepY.y() * srcBytesPerLine + stepY.x() * 4;
+
+    const uchar *srcBits = src.constBits();
+    uchar *dstBits = dst.bits();
+    const qint64 dstBytesPerLine = dst.bytesPerLine();
+    const int dstWidth = dst.width();
+
+    ParallelRows::forEachBand(dst.height(), dstBytesPerLine, [&](int firstRow, int endRow) {
+        if (control.isCanceled()) return;
+        for (int tileY = firstRow; tileY < endRow; tileY += TileSize) {
+            const int tileEndY = qMin(tileY + TileSize, endRow);
+            for (int tileX = 0; tileX < dstWidth; tileX += TileSize) {
+                const int tileEndX = qMin(tileX + TileSize, dstWidth);
+                for (int y = tileY; y < tileEndY; y++) {
+                    const uchar *in = srcBits + originBytes + y * stepYBytes;
+                    QRgb *out = reinterpret_cast<QRgb*>(dstBits + y * dstBytesPerLine);
+                    for (int x = tileX; x < tileEndX; x++) {
+                        QRgb pixel = *reinterpret_cast<const QRgb*>(in + x * stepXBytes);
+                        out[x] = UseLut ? lut.map(pixel) : pixel;
+                    }
+                }
+            }
+        }
+        control.addProgress(endRow - firstRow);
+    });
+}
+
+} // namespace
+
+void FilterPipeline::append(std::shared_ptr<const Filter> filter) {
+    if (!filter) return;
+    filters.append(filter);
+
+    Orientation orientation;
+    ChannelLut lut;
+    bool isGeometry = filter->describeGeometry(orientation);
+    bool isLut = !isGeometry && filter->describeLut(lut);
+
+    if (!isGeometry && !isLut) {
+        Stage stage;
+        stage.opaque = filter;
+        stages.append(stage);
+        return;
+    }
+
+    // Nový popsatelný filtr se připojí k předchozí skupině, pokud existuje
+    if (stages.isEmpty() || stages.last().opaque) {
+        stages.append(Stage());
+    }
+    Stage &stage = stages.last();
+    if (isGeometry) {
+        stage.orientation = stage.orientation.then(orientation);
+    } else {
+        // Tabulky komutují s permutací pixelů - pořadí vůči geometrii nehraje roli
+        stage.lut = stage.hasLut ? stage.lut.then(lut) : lut;
+        stage.hasLut = true;
+    }
+}
+
+void FilterPipeline::clear() {
+    filters.clear();
+    stages.clear();
+}
+
+int FilterPipeline::passCount() const {
+    int passes = 0;
+    for (const Stage &stage : stages) {
+        if (stage.opaque || !stage.orientation.isIdentity() || (stage.hasLut && !stage.lut.isIdentity())) {
+            passes++;
+        }
+    }
+    return passes;
+}
+
+QString FilterPipeline::name() const {
+    QStringList names;
+    for (const auto &filter : filters) {
+        names.append(filter->name());
+    }
+    return names.isEmpty() ? QString("Pipeline") : names.join(" > ");
+}
+
+QImage FilterPipeline::apply(const QImage& image) const {
+    return applyCancellable(image, JobControl::none());
+}
+
+QImage FilterPipeline::applyCancellable(const QImage& image, const JobControl& control) const {
+    QImage result = image;
+    for (const Stage &stage : stages) {
+        if (result.isNull() || control.isCanceled()) break;
+        result = stage.opaque ? stage.opaque->applyCancellable(result, control) : applyFused(result, stage, control);
+    }
+    return result;
+}
+
+QImage FilterPipeline::applyFused(const QImage &image, const Stage &stage, const JobControl &control) {
+    const bool useLut = stage.hasLut && !stage.lut.isIdentity();
+    const Orientation &orientation = stage.orientation;
+    if (!useLut && orientation.isIdentity()) {
+        return image;
+    }
+    if (!useLut && !orientation.mirrored) {
+        return Rotation::rotate(image, orientation.quarterTurns, control);
+    }
+
+    // Průchod pracuje s 32bitovými pixely bez předem vynásobené alfy
+    QImage src = image;
+    if (src.format() != QImage::Format_RGB32 && src.format() != QImage::Format_ARGB32) {
+        src = src.convertToFormat(src.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+
+    if (orientation.isIdentity()) {
+        QImage result = src.copy();
+        uchar *bits = result.bits();
+        const qint64 bytesPerLine = result.bytesPerLine();
+        const int width = result.width();
+        control.beginProgress(result.height());
+        ParallelRows::forEachBand(result.height(), bytesPerLine, [&](int firstRow, int endRow) {
+            if (control.isCanceled()) return;
+            for (int y = firstRow; y < endRow; y++) {
+                stage.lut.applyToRow(reinterpret_cast<QRgb*>(bits + y * bytesPerLine), width);
+            }
+            control.addProgress(endRow - firstRow);
+        });
+        return result;
+    }
+
+    const bool swapsSize = orientation.quarterTurns % 2 != 0;
+    QImage result(swapsSize ? src.height() : src.width(),
+                  swapsSize ? src.width() : src.height(), src.format());
+    if (result.isNull()) {
+        return result;
+    }
+    control.beginProgress(result.height());
+    if (useLut) {
+        traverse<true>(src, result, orientation, stage.lut, control);
+    } else {
+        traverse<false>(src, result, orientation, stage.lut, control);
+    }
+    return result;
+}
+
+bool FilterPipeline::isRowLocal() const {
+    // Po řádcích lze zpracovat jen zrcadlení a barevné tabulky
+    for (const Stage &stage : stages) {
+        if (stage.opaque ? !stage.opaque->isRowLocal() : stage.orientation.quarterTurns != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FilterPipeline::applyToRow(QRgb *row, int width) const {
+    for (const Stage &stage : stages) {
+        if (stage.opaque) {
+            stage.opaque->applyToRow(row, width);
+            continue;
+        }
+        if (stage.hasLut) {
+            stage.lut.applyToRow(row, width);
+        }
+        if (stage.orientation.mirrored) {
+            std::reverse(row, row + width);
+        }
+    }
+}
+
+std::shared_ptr<const Filter> FilterPipeline::inverse() const {
+    // Inverze řetězce = inverze filtrů v opačném pořadí
+    auto result = std::make_shared<FilterPipeline>();
+    for (int i = filters.size() - 1; i >= 0; i--) {
+        std::shared_ptr<const Filter> filterInverse = filters[i]->inverse();
+        if (!filterInverse) return nullptr;
+        result->append(filterInverse);
+    }
+    return result;
+}
+
+bool FilterPipeline::applyToIndexed(IndexedImage &image) const {
+    // Pracuje se na kopii, aby neúspěch uprostřed řetězce nic nezměnil
+    IndexedImage result = image;
+    for (const Stage &stage : stages) {
+        if (stage.opaque) {
+            if (!stage.opaque->applyToIndexed(result)) return false;
+            continue;
+        }
+
+        // Tabulka se použije na paletu, geometrie na zabalené indexy
+        if (stage.hasLut) {
+            stage.lut.applyToRow(result.palette.data(), result.palette.size());
+        }
+        const Orientation &orientation = stage.orientation;
+        if (orientation.isIdentity()) continue;
+        if (!IndexedTransforms::hasCompleteRows(result)) return false;
+
+        // Otočení o 180° = převrácení v obou osách a komutuje se vším,
+        // takže se provede před zbývající čtvrtotáčkou; zrcadlení a
+        // horizontální převrácení se přitom mohou vyrušit
+        bool halfTurn = orientation.quarterTurns >= 2;
+        if (orientation.mirrored != halfTurn) {
+            result = IndexedTransforms::flipHorizontal(result);
+        }
+        if (halfTurn) {
+            result = IndexedTransforms::flipVertical(result);
+        }
+        if (orientation.quarterTurns % 2 != 0) {
+            result = IndexedTransforms::rotate90(result);
+        }
+    }
+    image = result;
+    return true;
+}
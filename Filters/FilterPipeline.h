@@ -0,0 +1,47 @@
+#ifndef FILTERPIPELINE_H
+#define FILTERPIPELINE_H
+
+#include "Filter.h"
+
+#include <QVector>
+#include <memory>
+
+// Řetězec filtrů, který se před spuštěním zjednoduší. Po sobě jdoucí
+// geometrické filtry (otočení, převrácení) se složí do jednoho prvku
+// dihedrální grupy a barevné filtry (inverze) do jedné tabulky; taková
+// skupina se pak provede jedním průchodem obrázkem. Filtry, které se
+// popsat nedají, se spouštějí samostatně v původním pořadí.
+class FilterPipeline : public Filter {
+public:
+    void append(std::shared_ptr<const Filter> filter);
+    void clear();
+    bool isEmpty() const { return filters.isEmpty(); }
+    int size() const { return filters.size(); }
+
+    // Počet průchodů obrázkem po zjednodušení
+    int passCount() const;
+
+    QImage apply(const QImage& image) const override;
+    QImage applyCancellable(const QImage& image, const JobControl& control) const override;
+    QString name() const override;
+    bool isRowLocal() const override;
+    void applyToRow(QRgb *row, int width) const override;
+    bool applyToIndexed(IndexedImage &image) const override;
+    std::shared_ptr<const Filter> inverse() const override;
+
+private:
+    // Buď složená skupina popsatelných filtrů, nebo jeden samostatný filtr
+    struct Stage {
+        Orientation orientation;
+        ChannelLut lut;
+        bool hasLut = false;
+        std::shared_ptr<const Filter> opaque;
+    };
+
+    QVector<std::shared_ptr<const Filter>> filters;
+    QVector<Stage> stages;
+
+    static QImage applyFused(const QImage &image, const Stage &stage, const JobControl &control);
+};
+
+#endif // FILTERPIPELINE_H
@@ -1,6 +1,31 @@
 #include "FlipFilter.h"
+#include "IndexedTransforms.h"
+
+#include <algorithm>
 
 QImage FlipFilter::apply(const QImage& image) const {
     if (image.isNull()) return image;
     return image.mirrored(true, false);
-}
\ No newline at end of file
+}
+
+void FlipFilter::applyToRow(QRgb *row, int width) const {
+    // Horizontální převrácení = obrácené pořadí pixelů v řádku
+    std::reverse(row, row + width);
+}
+
+bool FlipFilter::applyToIndexed(IndexedImage &image) const {
+    // Převrácení přímo nad indexy - bez převodu na RGB a zpětné kvantizace
+    if (!IndexedTransforms::hasCompleteRows(image)) return false;
+    image = IndexedTransforms::flipHorizontal(image);
+    return true;
+}
+
+std::shared_ptr<const Filter> FlipFilter::inverse() const {
+    return std::make_shared<FlipFilter>();
+}
+
+bool FlipFilter::describeGeometry(Orientation &orientation) const {
+    orientation.mirrored = true;
+    orientation.quarterTurns = 0;
+    return true;
+}
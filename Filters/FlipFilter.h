@@ -7,6 +7,11 @@ class FlipFilter : public Filter {
 public:
 QImage apply(const QImage& image) const override;
     QString name() const override { return "Flip Horizontal"; }
+    bool isRowLocal() const override { return true; }
+    void applyToRow(QRgb *row, int width) const override;
+    bool applyToIndexed(IndexedImage &image) const override;
+    std::shared_ptr<const Filter> inverse() const override;
+    bool describeGeometry(Orientation &orientation) const override;
 };
 
 #endif // FLIPFILTER_H
\ No newline at end of file
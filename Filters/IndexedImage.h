@@ -0,0 +1,20 @@
+#ifndef INDEXEDIMAGE_H
+#define INDEXEDIMAGE_H
+
+#include <QByteArray>
+#include <QRgb>
+#include <QVector>
+
+// Obrázek s paletou (1, 4 nebo 8 bitů) v původní podobě BMP dat:
+// paleta + zabalené indexy, řádky zarovnané na 4 bajty.
+// Filtry s ním mohou pracovat přímo, bez převodu na RGB a zpětné kvantizace.
+struct IndexedImage {
+    QVector<QRgb> palette;
+    QByteArray rows;
+    int width;
+    int height;
+    int bitsPerPixel;
+    bool bottomUp;  // BMP ukládá řádky odspodu nahoru, pokud biHeight > 0
+};
+
+#endif // INDEXEDIMAGE_H
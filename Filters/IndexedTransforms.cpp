@@ -0,0 +1,155 @@
+#include "IndexedTransforms.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+qint64 rowSize(int width, int bitsPerPixel) {
+    return ((static_cast<qint64>(width) * bitsPerPixel + 31) / 32) * 4;
+}
+
+// Tabulka obrácených bitů v bajtu (pro 1bitové řádky)
+const uchar *bitReversalTable() {
+    static uchar table[256];
+    static bool initialized = [] {
+        for (int i = 0; i < 256; i++) {
+            uchar reversed = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (i & (1 << bit)) {
+                    reversed |= static_cast<uchar>(0x80 >> bit);
+                }
+            }
+            table[i] = reversed;
+        }
+        return true;
+    }();
+    Q_UNUSED(initialized);
+    return table;
+}
+
+inline uchar swapNibbles(uchar value) {
+    return static_cast<uchar>((value << 4) | (value >> 4));
+}
+
+inline int pixelIndex(const uchar *row, int x, int bitsPerPixel) {
+    switch (bitsPerPixel) {
+        case 1: return (row[x >> 3] >> (7 - (x & 7))) & 0x01;
+        case 4: return (x & 1) ? row[x >> 1] & 0x0F : row[x >> 1] >> 4;
+        default: return row[x];
+    }
+}
+
+inline void setPixelIndex(uchar *row, int x, int bitsPerPixel, int index) {
+    switch (bitsPerPixel) {
+        case 1: row[x >> 3] |= static_cast<uchar>(index << (7 - (x & 7))); break;
+        case 4: row[x >> 1] |= static_cast<uchar>((x & 1) ? index : index << 4); break;
+        default: row[x] = static_cast<uchar>(index); break;
+    }
+}
+
+// Posun řádku o 'bits' bitů doleva (0 < bits < 8) - po obrácení bajtů
+// je potřeba odstranit zarovnání, které se dostalo na začátek řádku
+void shiftRowLeft(uchar *row, int bytes, int bits) {
+    for (int i = 0; i < bytes - 1; i++) {
+        row[i] = static_cast<uchar>((row[i] << bits) | (row[i + 1] >> (8 - bits)));
+    }
+    row[bytes - 1] = static_cast<uchar>(row[bytes - 1] << bits);
+}
+
+// Logický řádek (shora dolů) -> index uloženého řádku
+inline int storedRow(const IndexedImage &image, int y) {
+    return image.bottomUp ? image.height - 1 - y : y;
+}
+
+IndexedImage emptyLike(const IndexedImage &image, int width, int height) {
+    IndexedImage result = image;
+    result.width = width;
+    result.height = height;
+    result.rows = QByteArray(static_cast<int>(rowSize(width, image.bitsPerPixel) * height), 0);
+    return result;
+}
+
+} // namespace
+
+bool IndexedTransforms::hasCompleteRows(const IndexedImage &image) {
+    return image.width > 0 && image.height > 0 &&
+           (image.bitsPerPixel == 1 || image.bitsPerPixel == 4 || image.bitsPerPixel == 8) &&
+           image.rows.size() >= rowSize(image.width, image.bitsPerPixel) * image.height;
+}
+
+IndexedImage IndexedTransforms::flipHorizontal(const IndexedImage &image) {
+    IndexedImage result = emptyLike(image, image.width, image.height);
+    const qint64 bytesPerRow = rowSize(image.width, image.bitsPerPixel);
+    const int usedBytes = static_cast<int>((static_cast<qint64>(image.width) * image.bitsPerPixel + 7) / 8);
+    const int padBits = usedBytes * 8 - image.width * image.bitsPerPixel;
+    const uchar *reverse = bitReversalTable();
+
+    const uchar *src = reinterpret_cast<const uchar*>(image.rows.constData());
+    uchar *dst = reinterpret_cast<uchar*>(result.rows.data());
+
+    for (int row = 0; row < image.height; row++) {
+        const uchar *in = src + row * bytesPerRow;
+        uchar *out = dst + row * bytesPerRow;
+
+        if (image.bitsPerPixel == 8) {
+            std::reverse_copy(in, in + image.width, out);
+            continue;
+        }
+
+        // Obrácení pořadí bajtů a pixelů uvnitř bajtu; zarovnání na konci
+        // posledního bajtu se tím dostane na začátek a musí se odsunout
+        for (int i = 0; i < usedBytes; i++) {
+            uchar value = in[usedBytes - 1 - i];
+            out[i] = (image.bitsPerPixel == 1) ? reverse[value] : swapNibbles(value);
+        }
+        if (padBits > 0) {
+            shiftRowLeft(out, usedBytes, padBits);
+        }
+    }
+    return result;
+}
+
+IndexedImage IndexedTransforms::flipVertical(const IndexedImage &image) {
+    IndexedImage result = emptyLike(image, image.width, image.height);
+    const qint64 bytesPerRow = rowSize(image.width, image.bitsPerPixel);
+    const char *src = image.rows.constData();
+    char *dst = result.rows.data();
+
+    for (int row = 0; row < image.height; row++) {
+        std::memcpy(dst + row * bytesPerRow, src + (image.height - 1 - row) * bytesPerRow, bytesPerRow);
+    }
+    return result;
+}
+
+IndexedImage IndexedTransforms::rotate90(const IndexedImage &image) {
+    // Po otočení: nová šířka = výška, nová výška = šířka;
+    // cílový pixel (x', y') pochází ze zdrojového (y', výška - 1 - x')
+    IndexedImage result = emptyLike(image, image.height, image.width);
+    const int bpp = image.bitsPerPixel;
+    const qint64 srcBytesPerRow = rowSize(image.width, bpp);
+    const qint64 dstBytesPerRow = rowSize(result.width, bpp);
+
+    const uchar *src = reinterpret_cast<const uchar*>(image.rows.constData());
+    uchar *dst = reinterpret_cast<uchar*>(result.rows.data());
+
+    // Ukazatele na zdrojové řádky v logickém pořadí shora dolů
+    QVector<const uchar*> srcRows(image.height);
+    for (int y = 0; y < image.height; y++) {
+        srcRows[y] = src + storedRow(image, y) * srcBytesPerRow;
+    }
+
+    for (int y = 0; y < result.height; y++) {
+        uchar *out = dst + storedRow(result, y) * dstBytesPerRow;
+        if (bpp == 8) {
+            for (int x = 0; x < result.width; x++) {
+                out[x] = srcRows[image.height - 1 - x][y];
+            }
+        } else {
+            for (int x = 0; x < result.width; x++) {
+                setPixelIndex(out, x, bpp, pixelIndex(srcRows[image.height - 1 - x], y, bpp));
+            }
+        }
+    }
+    return result;
+}
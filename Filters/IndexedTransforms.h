@@ -0,0 +1,22 @@
+#ifndef INDEXEDTRANSFORMS_H
+#define INDEXEDTRANSFORMS_H
+
+#include "IndexedImage.h"
+
+// Bezeztrátové geometrické transformace nad zabalenými indexy (1, 4, 8 bitů).
+// Paleta ani hodnoty indexů se nemění, mění se jen jejich pořadí.
+namespace IndexedTransforms {
+    // Transformace vyžadují kompletní data (zkrácený soubor se zpracuje přes RGB)
+    bool hasCompleteRows(const IndexedImage &image);
+
+    // Horizontální převrácení každého řádku
+    IndexedImage flipHorizontal(const IndexedImage &image);
+
+    // Obrácení pořadí řádků (vertikální převrácení)
+    IndexedImage flipVertical(const IndexedImage &image);
+
+    // Otočení o 90° po směru hodinových ručiček
+    IndexedImage rotate90(const IndexedImage &image);
+}
+
+#endif // INDEXEDTRANSFORMS_H
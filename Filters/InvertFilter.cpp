@@ -1,10 +1,33 @@
 #include "InvertFilter.h"
+#include "../JobControl.h"
+#include "../ParallelRows.h"
 
 QImage InvertFilter::apply(const QImage& image) const {
+    return applyCancellable(image, JobControl::none());
+}
+
+QImage InvertFilter::applyCancellable(const QImage& image, const JobControl& control) const {
     if (image.isNull()) return image;
 
     QImage result = image.copy();
-    for (int y = 0; y < result.height(); ++y) {
+    control.beginProgress(result.height());
+
+    // 32bitové pixely se invertují přímo po řádcích, paralelně po pásech
+    if (result.format() == QImage::Format_RGB32 || result.format() == QImage::Format_ARGB32) {
+        uchar *bits = result.bits();
+        const qint64 bytesPerLine = result.bytesPerLine();
+        const int width = result.width();
+        ParallelRows::forEachBand(result.height(), bytesPerLine, [&](int firstRow, int endRow) {
+            if (control.isCanceled()) return;
+            for (int y = firstRow; y < endRow; ++y) {
+                applyToRow(reinterpret_cast<QRgb*>(bits + y * bytesPerLine), width);
+            }
+            control.addProgress(endRow - firstRow);
+        });
+        return result;
+    }
+
+    for (int y = 0; y < result.height() && !control.isCanceled(); ++y) {
         for (int x = 0; x < result.width(); ++x) {
             QColor color = result.pixelColor(x, y);
             color.setRed(255 - color.red());
@@ -12,6 +35,31 @@ QImage InvertFilter::apply(const QImage& image) const {
             color.setBlue(255 - color.blue());
             result.setPixelColor(x, y, color);
         }
+        control.addProgress(1);
     }
     return result;
-}
\ No newline at end of file
+}
+
+void InvertFilter::applyToRow(QRgb *row, int width) const {
+    // Inverze kanálů R, G, B (alfa zůstává beze změny)
+    for (int x = 0; x < width; ++x) {
+        row[x] ^= 0x00ffffff;
+    }
+}
+
+bool InvertFilter::applyToIndexed(IndexedImage &image) const {
+    // U obrázku s paletou stačí invertovat barvy palety, indexy zůstávají
+    applyToRow(image.palette.data(), image.palette.size());
+    return true;
+}
+
+std::shared_ptr<const Filter> InvertFilter::inverse() const {
+    return std::make_shared<InvertFilter>();
+}
+
+bool InvertFilter::describeLut(ChannelLut &lut) const {
+    for (int i = 0; i < 256; i++) {
+        lut.red[i] = lut.green[i] = lut.blue[i] = static_cast<uchar>(255 - i);
+    }
+    return true;
+}
@@ -6,7 +6,13 @@
 class InvertFilter : public Filter {
 public:
     QImage apply(const QImage& image) const override;
+    QImage applyCancellable(const QImage& image, const JobControl& control) const override;
     QString name() const override { return "Invert Colors"; }
+    bool isRowLocal() const override { return true; }
+    void applyToRow(QRgb *row, int width) const override;
+    bool applyToIndexed(IndexedImage &image) const override;
+    std::shared_ptr<const Filter> inverse() const override;
+    bool describeLut(ChannelLut &lut) const override;
 };
 
 #endif // INVERTFILTER_H
\ No newline at end of file
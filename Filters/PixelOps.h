@@ -0,0 +1,75 @@
+#ifndef PIXELOPS_H
+#define PIXELOPS_H
+
+#include <QRgb>
+
+// Popis filtrů pro skládání (FilterPipeline). Geometrické filtry jen
+// přeskládají pixely a jejich složení je opět jeden prvek dihedrální grupy,
+// barevné filtry mapují každý kanál nezávisle a složí se do jedné tabulky.
+
+// Prvek dihedrální grupy: nejdřív případné horizontální zrcadlení,
+// potom 'quarterTurns' čtvrtotáček po směru hodinových ručiček
+struct Orientation {
+    bool mirrored = false;
+    int quarterTurns = 0;  // 0 až 3
+
+    bool isIdentity() const { return !mirrored && quarterTurns == 0; }
+
+    // Výsledek použití této transformace a po ní 'next'.
+    // Otočení a následné zrcadlení = zrcadlení a otočení opačným směrem.
+    Orientation then(const Orientation &next) const {
+        Orientation result;
+        result.mirrored = mirrored != next.mirrored;
+        result.quarterTurns = next.mirrored ? (next.quarterTurns - quarterTurns + 4) % 4
+                                            : (quarterTurns + next.quarterTurns) % 4;
+        return result;
+    }
+};
+
+// Tabulka pro každý barevný kanál (alfa zůstává beze změny)
+struct ChannelLut {
+    uchar red[256];
+    uchar green[256];
+    uchar blue[256];
+
+    static ChannelLut identity() {
+        ChannelLut lut;
+        for (int i = 0; i < 256; i++) {
+            lut.red[i] = lut.green[i] = lut.blue[i] = static_cast<uchar>(i);
+        }
+        return lut;
+    }
+
+    bool isIdentity() const {
+        for (int i = 0; i < 256; i++) {
+            if (red[i] != i || green[i] != i || blue[i] != i) return false;
+        }
+        return true;
+    }
+
+    // Výsledek použití této tabulky a po ní 'next'
+    ChannelLut then(const ChannelLut &next) const {
+        ChannelLut result;
+        for (int i = 0; i < 256; i++) {
+            result.red[i] = next.red[red[i]];
+            result.green[i] = next.green[green[i]];
+            result.blue[i] = next.blue[blue[i]];
+        }
+        return result;
+    }
+
+    QRgb map(QRgb pixel) const {
+        return (pixel & 0xff000000u)
+               | (static_cast<QRgb>(red[(pixel >> 16) & 0xff]) << 16)
+               | (static_cast<QRgb>(green[(pixel >> 8) & 0xff]) << 8)
+               | blue[pixel & 0xff];
+    }
+
+    void applyToRow(QRgb *row, int width) const {
+        for (int x = 0; x < width; x++) {
+            row[x] = map(row[x]);
+        }
+    }
+};
+
+#endif // PIXELOPS_H
@@ -1,7 +1,38 @@
 #include "RotateFilter.h"
-#include <QTransform>
+#include "IndexedTransforms.h"
+#include "Rotation.h"
+
+RotateFilter::RotateFilter(int angle)
+    : quarterTurns((((angle / 90) % 4) + 4) % 4) {}
 
 QImage RotateFilter::apply(const QImage& image) const {
+    return applyCancellable(image, JobControl::none());
+}
+
+QImage RotateFilter::applyCancellable(const QImage& image, const JobControl& control) const {
     if (image.isNull()) return image;
-    return image.transformed(QTransform().rotate(90));
-}
\ No newline at end of file
+    return Rotation::rotate(image, quarterTurns, control);
+}
+
+bool RotateFilter::applyToIndexed(IndexedImage &image) const {
+    // Otočení přímo nad indexy - bez převodu na RGB a zpětné kvantizace
+    if (!IndexedTransforms::hasCompleteRows(image)) return false;
+    if (quarterTurns % 2 == 1) {
+        image = IndexedTransforms::rotate90(image);
+    }
+    if (quarterTurns >= 2) {
+        // 180° = převrácení v obou osách
+        image = IndexedTransforms::flipVertical(IndexedTransforms::flipHorizontal(image));
+    }
+    return true;
+}
+
+std::shared_ptr<const Filter> RotateFilter::inverse() const {
+    return std::make_shared<RotateFilter>(90 * ((4 - quarterTurns) % 4));
+}
+
+bool RotateFilter::describeGeometry(Orientation &orientation) const {
+    orientation.mirrored = false;
+    orientation.quarterTurns = quarterTurns;
+    return true;
+}
@@ -5,8 +5,18 @@
 
 class RotateFilter : public Filter {
 public:
+    // Úhel po směru hodinových ručiček, zaokrouhlí se na násobek 90°
+    explicit RotateFilter(int angle = 90);
+
     QImage apply(const QImage& image) const override;
-    QString name() const override { return "Rotate 90°"; }
+    QImage applyCancellable(const QImage& image, const JobControl& control) const override;
+    QString name() const override { return QString("Rotate %1°").arg(90 * quarterTurns); }
+    bool applyToIndexed(IndexedImage &image) const override;
+    std::shared_ptr<const Filter> inverse() const override;
+    bool describeGeometry(Orientation &orientation) const override;
+
+private:
+    int quarterTurns;  // 0 až 3
 };
 
-#endif // ROTATEFILTER_H
\ No newline at end of file
+#endif // ROTATEFILTER_H
@@ -0,0 +1,178 @@
+#include "Rotation.h"
+#include "../ParallelRows.h"
+
+#include <QTransform>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ROTATION_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ROTATION_SSE2
+#endif
+
+namespace {
+
+// 64x64 pixelů = 16 kB zdroje + 16 kB cíle
+const int TileSize = 64;
+
+// Transpozice bloku 4x4: řádky s0..s3 (po 4 pixelech) -> řádky d0..d3
+inline void transpose4x4(const quint32 *s0, const quint32 *s1, const quint32 *s2, const quint32 *s3,
+                         quint32 *d0, quint32 *d1, quint32 *d2, quint32 *d3) {
+#if defined(ROTATION_SSE2)
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s3));
+    __m128i ab01 = _mm_unpacklo_epi32(a, b);  // a0 b0 a1 b1
+    __m128i cd01 = _mm_unpacklo_epi32(c, d);  // c0 d0 c1 d1
+    __m128i ab23 = _mm_unpackhi_epi32(a, b);  // a2 b2 a3 b3
+    __m128i cd23 = _mm_unpackhi_epi32(c, d);  // c2 d2 c3 d3
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d0), _mm_unpacklo_epi64(ab01, cd01));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d1), _mm_unpackhi_epi64(ab01, cd01));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d2), _mm_unpacklo_epi64(ab23, cd23));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d3), _mm_unpackhi_epi64(ab23, cd23));
+#elif defined(ROTATION_NEON)
+    uint32x4x2_t ab = vtrnq_u32(vld1q_u32(s0), vld1q_u32(s1));  // a0 b0 a2 b2 | a1 b1 a3 b3
+    uint32x4x2_t cd = vtrnq_u32(vld1q_u32(s2), vld1q_u32(s3));  // c0 d0 c2 d2 | c1 d1 c3 d3
+    vst1q_u32(d0, vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0])));
+    vst1q_u32(d1, vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1])));
+    vst1q_u32(d2, vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0])));
+    vst1q_u32(d3, vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1])));
+#else
+    quint32 *dst[4] = {d0, d1, d2, d3};
+    for (int i = 0; i < 4; i++) {
+        dst[i][0] = s0[i];
+        dst[i][1] = s1[i];
+        dst[i][2] = s2[i];
+        dst[i][3] = s3[i];
+    }
+#endif
+}
+
+inline const quint32 *srcLine(const QImage &image, int y) {
+    return reinterpret_cast<const quint32*>(image.constScanLine(y));
+}
+
+inline quint32 *dstLine(uchar *bits, qint64 bytesPerLine, int y) {
+    return reinterpret_cast<quint32*>(bits + y * bytesPerLine);
+}
+
+// Otočení o 90° po směru (clockwise) nebo proti směru hodinových ručiček.
+// Cíl má rozměry výška x šířka zdroje:
+//   po směru:   cíl(x, y) = zdroj(y, výška - 1 - x)
+//   proti směru: cíl(x, y) = zdroj(šířka - 1 - y, x)
+void rotateQuarter(const QImage &src, QImage &dst, bool clockwise, const JobControl &control) {
+    const int srcWidth = src.width();
+    const int srcHeight = src.height();
+    const int dstWidth = dst.width();
+    uchar *bits = dst.bits();
+    const qint64 bytesPerLine = dst.bytesPerLine();
+
+    ParallelRows::forEachBand(dst.height(), bytesPerLine, [&](int firstRow, int endRow) {
+        if (control.isCanceled()) return;
+        for (int tileY = firstRow; tileY < endRow; tileY += TileSize) {
+            const int tileEndY = qMin(tileY + TileSize, endRow);
+            for (int tileX = 0; tileX < dstWidth; tileX += TileSize) {
+                const int tileEndX = qMin(tileX + TileSize, dstWidth);
+
+                int y = tileY;
+                for (; y + 4 <= tileEndY; y += 4) {
+                    int x = tileX;
+                    for (; x + 4 <= tileEndX; x += 4) {
+                        if (clockwise) {
+                            const int row = srcHeight - 1 - x;
+                            transpose4x4(srcLine(src, row) + y, srcLine(src, row - 1) + y,
+                                         srcLine(src, row - 2) + y, srcLine(src, row - 3) + y,
+                                         dstLine(bits, bytesPerLine, y) + x, dstLine(bits, bytesPerLine, y + 1) + x,
+                                         dstLine(bits, bytesPerLine, y + 2) + x, dstLine(bits, bytesPerLine, y + 3) + x);
+                        } else {
+                            const int column = srcWidth - 4 - y;
+                            transpose4x4(srcLine(src, x) + column, srcLine(src, x + 1) + column,
+                                         srcLine(src, x + 2) + column, srcLine(src, x + 3) + column,
+                                         dstLine(bits, bytesPerLine, y + 3) + x, dstLine(bits, bytesPerLine, y + 2) + x,
+                                         dstLine(bits, bytesPerLine, y + 1) + x, dstLine(bits, bytesPerLine, y) + x);
+                        }
+                    }
+                    // Zbytek dlaždice, který netvoří celý blok 4x4
+                    for (int row = y; row < y + 4; row++) {
+                        quint32 *out = dstLine(bits, bytesPerLine, row);
+                        for (int col = x; col < tileEndX; col++) {
+                            out[col] = clockwise ? srcLine(src, srcHeight - 1 - col)[row]
+                                                 : srcLine(src, col)[srcWidth - 1 - row];
+                        }
+                    }
+                }
+                for (; y < tileEndY; y++) {
+                    quint32 *out = dstLine(bits, bytesPerLine, y);
+                    for (int col = tileX; col < tileEndX; col++) {
+                        out[col] = clockwise ? srcLine(src, srcHeight - 1 - col)[y]
+                                             : srcLine(src, col)[srcWidth - 1 - y];
+                    }
+                }
+            }
+        }
+        control.addProgress(endRow - firstRow);
+    });
+}
+
+// Otočení o 180° - každý řádek je obrácený řádek ze spodní části
+void rotateHalf(const QImage &src, QImage &dst, const JobControl &control) {
+    const int width = src.width();
+    const int height = src.height();
+    uchar *bits = dst.bits();
+    const qint64 bytesPerLine = dst.bytesPerLine();
+
+    ParallelRows::forEachBand(height, bytesPerLine, [&](int firstRow, int endRow) {
+        if (control.isCanceled()) return;
+        for (int y = firstRow; y < endRow; y++) {
+            const quint32 *in = srcLine(src, height - 1 - y);
+            quint32 *out = dstLine(bits, bytesPerLine, y);
+            int x = 0;
+#if defined(ROTATION_SSE2)
+            for (; x + 4 <= width; x += 4) {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + width - 4 - x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_shuffle_epi32(pixels, 0x1B));
+            }
+#elif defined(ROTATION_NEON)
+            for (; x + 4 <= width; x += 4) {
+                uint32x4_t pixels = vrev64q_u32(vld1q_u32(in + width - 4 - x));
+                vst1q_u32(out + x, vcombine_u32(vget_high_u32(pixels), vget_low_u32(pixels)));
+            }
+#endif
+            for (; x < width; x++) {
+                out[x] = in[width - 1 - x];
+            }
+        }
+        control.addProgress(endRow - firstRow);
+    });
+}
+
+} // namespace
+
+QImage Rotation::rotate(const QImage &image, int quarterTurns, const JobControl &control) {
+    const int turns = ((quarterTurns % 4) + 4) % 4;
+    if (image.isNull() || turns == 0) {
+        return image;
+    }
+
+    // Jiné bitové hloubky zvládne obecná transformace Qt
+    if (image.depth() != 32) {
+        return image.transformed(QTransform().rotate(90 * turns));
+    }
+
+    const bool swapsSize = (turns % 2) != 0;
+    QImage result(swapsSize ? image.height() : image.width(),
+                  swapsSize ? image.width() : image.height(), image.format());
+    if (result.isNull()) {
+        return result;
+    }
+
+    control.beginProgress(result.height());
+    if (turns == 2) {
+        rotateHalf(image, result, control);
+    } else {
+        rotateQuarter(image, result, turns == 1, control);
+    }
+    return result;
+}
@@ -0,0 +1,19 @@
+#ifndef ROTATION_H
+#define ROTATION_H
+
+#include <QImage>
+
+#include "../JobControl.h"
+
+// Otočení 32bitového obrázku o násobek 90° (čistá permutace pixelů).
+// Obrázek se zpracovává po dlaždicích, které se vejdou do L1 cache,
+// uvnitř dlaždice se bloky 4x4 pixelů transponují pomocí SIMD a
+// řádky dlaždic se zpracovávají paralelně.
+namespace Rotation {
+    // Počet čtvrtotáček po směru hodinových ručiček (libovolné celé číslo).
+    // Jiné než 32bitové formáty se otočí přes QTransform.
+    // Po zrušení přes 'control' je výsledek nekompletní.
+    QImage rotate(const QImage &image, int quarterTurns, const JobControl &control = JobControl::none());
+}
+
+#endif // ROTATION_H
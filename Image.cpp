@@ -1,8 +1,46 @@
 #include "Image.h"
+#include "BandWriter.h"
+#include "MappedFile.h"
+#include "MipPyramid.h"
+#include "ParallelRows.h"
+#include "RleCodec.h"
+#include "RowDecoder.h"
+#include "RowEncoder.h"
+#include "TiledImageStore.h"
+#include "Trace.h"
 #include "Filters/Filter.h"
-#include "customimagewidget.h"
+#include "Filters/IndexedImage.h"
 
-Image::Image() : imageWidth(0), imageHeight(0), imageBitsPerPixel(0), modified(false) {
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Tabulka barev QImage s indexy: přesně 2^bpp položek, indexy mimo paletu jsou černé
+// (stejně jako u RowDecoder)
+QVector<QRgb> colorTableFor(const QVector<QRgb> &palette, int bitsPerPixel) {
+    QVector<QRgb> colors(1 << bitsPerPixel, qRgb(0, 0, 0));
+    for (int i = 0; i < colors.size() && i < palette.size(); i++) {
+        colors[i] = palette[i];
+    }
+    return colors;
+}
+
+// Velikost pásu při zápisu po pásech - v paměti jsou najednou dva
+const qint64 WriteBandBytes = 4 * 1024 * 1024;
+
+} // namespace
+
+Image::Image() : imageWidth(0), imageHeight(0), imageBitsPerPixel(0), modified(false), rawDataValid(false),
+                 compressionOnSave(Compression::None), mappedRowsOffset(0) {
     // Inicializace struktur
     fileHeader = {0};
     infoHeader = {0};
@@ -10,271 +48,684 @@ Image::Image() : imageWidth(0), imageHeight(0), imageBitsPerPixel(0), modified(f
 
 Image::~Image() = default;
 
-bool Image::loadFromFile(const QString &filePath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
+bool Image::loadFromFile(const QString &filePath, LoadMode mode, const JobControl &control) {
+    std::shared_ptr<MappedFile> mapped;
+    QByteArray fileData;
+    {
+        BMP_TRACE_SCOPE("read file");
+        if (mode == LoadMode::Mapped || mode == LoadMode::Tiled) {
+            mapped = MappedFile::open(filePath);
+        }
+
+        if (!mapped) {
+            // Záložní varianta (např. když soubor nelze namapovat) - jedno čtení celého souboru
+            QFile file(filePath);
+            if (!file.open(QIODevice::ReadOnly)) {
+                return false;
+            }
+            fileData = file.readAll();
+            file.close();
+            BMP_TRACE_BYTES(fileData.size());
+        }
+    }
+
+    if (!loadFromSource(mapped, std::move(fileData), mode, control)) {
         return false;
     }
+    sourceFilePath = filePath;
+    return true;
+}
 
-    // Načtení file header
-    QByteArray fileHeaderData = file.read(14);
-    if (fileHeaderData.size() < 14 || fileHeaderData[0] != 'B' || fileHeaderData[1] != 'M') {
-        file.close();
+bool Image::loadFromData(QByteArray fileData, const JobControl &control) {
+    // Převzatá data se upravují na místě (odstranění hlaviček) bez kopie
+    if (!loadFromSource(nullptr, std::move(fileData), LoadMode::Buffered, control)) {
         return false;
     }
+    sourceFilePath.clear();
+    return true;
+}
 
-    // Parsování file header
-    fileHeader.bfType[0] = fileHeaderData[0];
-    fileHeader.bfType[1] = fileHeaderData[1];
-    fileHeader.bfSize = *reinterpret_cast<const uint32_t*>(fileHeaderData.data() + 2);
-    fileHeader.bfReserved1 = *reinterpret_cast<const uint16_t*>(fileHeaderData.data() + 6);
-    fileHeader.bfReserved2 = *reinterpret_cast<const uint16_t*>(fileHeaderData.data() + 8);
-    fileHeader.bfOffBits = *reinterpret_cast<const uint32_t*>(fileHeaderData.data() + 10);
+bool Image::loadFromSource(const std::shared_ptr<MappedFile> &mapped, QByteArray fileData, LoadMode mode,
+                           const JobControl &control) {
+    const uchar *data = nullptr;
+    qint64 dataSize = 0;
 
-    // Načtení info header
-    QByteArray infoHeaderData = file.read(40);
-    if (infoHeaderData.size() < 40) {
-        file.close();
-        return false;
+    if (mapped) {
+        // Hlavičky, paleta i pixely se čtou přímo z mapování - bez kopie
+        data = mapped->data();
+        dataSize = mapped->size();
+    } else {
+        data = reinterpret_cast<const uchar*>(fileData.constData());
+        dataSize = fileData.size();
+    }
+
+    // Parsování file header a info header
+    BMPFileHeader newFileHeader;
+    BMPInfoHeader newInfoHeader;
+    {
+        BMP_TRACE_SCOPE("parse headers");
+        if (!parseHeaders(data, dataSize, newFileHeader, newInfoHeader)) {
+            return false;
+        }
+
+        // Kontrola podporovaných formátů
+        if (!isSupported(newInfoHeader)) {
+            return false;
+        }
     }
 
-    // Parsování info header
-    infoHeader.biSize = *reinterpret_cast<const uint32_t*>(infoHeaderData.data() + 0);
-    infoHeader.biWidth = *reinterpret_cast<const int32_t*>(infoHeaderData.data() + 4);
-    infoHeader.biHeight = *reinterpret_cast<const int32_t*>(infoHeaderData.data() + 8);
-    infoHeader.biPlanes = *reinterpret_cast<const uint16_t*>(infoHeaderData.data() + 12);
-    infoHeader.biBitCount = *reinterpret_cast<const uint16_t*>(infoHeaderData.data() + 14);
-    infoHeader.biCompression = *reinterpret_cast<const uint32_t*>(infoHeaderData.data() + 16);
-    infoHeader.biSizeImage = *reinterpret_cast<const uint32_t*>(infoHeaderData.data() + 20);
-    infoHeader.biXPelsPerMeter = *reinterpret_cast<const int32_t*>(infoHeaderData.data() + 24);
-    infoHeader.biYPelsPerMeter = *reinterpret_cast<const int32_t*>(infoHeaderData.data() + 28);
-    infoHeader.biClrUsed = *reinterpret_cast<const uint32_t*>(infoHeaderData.data() + 32);
-    infoHeader.biClrImportant = *reinterpret_cast<const uint32_t*>(infoHeaderData.data() + 36);
-
-    // Kontrola podporovaných formátů
-    if (infoHeader.biCompression != 0 || 
-        (infoHeader.biBitCount != 1 && infoHeader.biBitCount != 4 && 
-         infoHeader.biBitCount != 8 && infoHeader.biBitCount != 24)) {
-        file.close();
+    // Pixelová data - v Qt5 je QByteArray omezen na 2 GB, větší obrázek lze
+    // zobrazit jen po dlaždicích dekódovaných přímo z mapování
+    qint64 pixelOffset = qMin<qint64>(newFileHeader.bfOffBits, dataSize);
+    qint64 pixelBytes = dataSize - pixelOffset;
+    const bool tilesFromMapping = mapped && mode == LoadMode::Tiled && !RleCodec::isRle(newInfoHeader.biCompression);
+    if (pixelBytes > INT_MAX && !tilesFromMapping) {
+        return false;
+    }
+    // Rozbalená RLE data musí do QByteArray vejít také
+    if (RleCodec::isRle(newInfoHeader.biCompression) &&
+        (newInfoHeader.biWidth <= 0 ||
+         calculateRowSize(newInfoHeader.biWidth, newInfoHeader.biBitCount) * newInfoHeader.biHeight > INT_MAX)) {
         return false;
     }
 
+    fileHeader = newFileHeader;
+    infoHeader = newInfoHeader;
+
     // Nastavení základních parametrů
     imageWidth = infoHeader.biWidth;
     imageHeight = abs(infoHeader.biHeight);
     imageBitsPerPixel = infoHeader.biBitCount;
 
-    // Načtení palety
+    // Načtení palety (následuje hned za hlavičkami, u V4/V5 tedy dál než na 54. bajtu)
     colorPalette.clear();
     if (imageBitsPerPixel <= 8) {
-        int paletteSize = (infoHeader.biClrUsed > 0) ? infoHeader.biClrUsed : (1 << imageBitsPerPixel);
-        QByteArray paletteData = file.read(paletteSize * 4);
+        BMP_TRACE_SCOPE("load palette");
+        qint64 paletteSize = (infoHeader.biClrUsed > 0) ? infoHeader.biClrUsed : (1 << imageBitsPerPixel);
+        const qint64 offset = qMin(paletteOffset(infoHeader), dataSize);
+        const uchar *paletteData = data + offset;
+        qint64 paletteAvailable = qMin<qint64>(paletteSize * 4, dataSize - offset);
 
-        for (int i = 0; i < paletteSize && i*4 < paletteData.size(); i++) {
-            int blue = static_cast<unsigned char>(paletteData[i*4]);
-            int green = static_cast<unsigned char>(paletteData[i*4+1]);
-            int red = static_cast<unsigned char>(paletteData[i*4+2]);
+        for (qint64 i = 0; i < paletteSize && i*4 + 2 < paletteAvailable; i++) {
+            int blue = paletteData[i*4];
+            int green = paletteData[i*4+1];
+            int red = paletteData[i*4+2];
             colorPalette.append(qRgb(red, green, blue));
         }
     }
 
-    // Čtení dat obrázku
-    file.seek(fileHeader.bfOffBits);
-    rawData = file.readAll();
-    file.close();
+    // Data obrázku: při mapování jen pohled do mapovaného souboru, jinak
+    // se z načteného bufferu odstraní hlavičky (bez další alokace)
+    if (RleCodec::isRle(infoHeader.biCompression)) {
+        // RLE se rozbalí rovnou do nekomprimovaných řádků, mapování pak není potřeba.
+        // Zkrácená data se tolerují stejně jako u BI_RGB - chybějící pixely zůstanou s indexem 0.
+        BMP_TRACE_SCOPE("decode rle");
+        RleCodec::decode(data + pixelOffset, pixelBytes, imageBitsPerPixel, imageWidth, imageHeight, rawData);
+        BMP_TRACE_BYTES(rawData.size());
+        mappedFile.reset();
+    } else if (mapped) {
+        // Řádky větší než QByteArray čtou jen dlaždice (rawData zůstanou prázdná)
+        rawData = pixelBytes <= INT_MAX ? QByteArray::fromRawData(reinterpret_cast<const char*>(data + pixelOffset),
+                                                                  static_cast<int>(pixelBytes))
+                                        : QByteArray();
+        mappedFile = mapped;
+        mappedRowsOffset = pixelOffset;
+    } else {
+        fileData.remove(0, static_cast<int>(pixelOffset));
+        rawData = fileData;
+        mappedFile.reset();
+    }
+    // Soubor načtený s RLE se tak i uloží (pokud komprese vyjde menší)
+    compressionOnSave = RleCodec::isRle(infoHeader.biCompression) ? Compression::RleIfSmaller : Compression::None;
 
-    // Převedení raw dat do QImage
-    renderFromRawData();
-    sourceFilePath = filePath;
+    // Převedení raw dat do QImage - po dlaždicích se dekóduje až při zobrazení
+    if (mode == LoadMode::Tiled) {
+        qImage = QImage();
+        tileStore = createTileStore();
+    } else {
+        // Při načítání se hotové řádky mohou průběžně zobrazovat
+        tileStore.reset();
+        renderFromRawData(control, true);
+    }
+    if (control.isCanceled()) {
+        *this = Image();
+        return false;
+    }
     modified = false;
+    rawDataValid = true;
+    dirtyRows = QBitArray();
+    mipPyramid.reset();
+    history.clear();
     
     return true;
 }
 
-bool Image::saveToFile(const QString &filePath) const {
+Image::ProbeInfo Image::probe(const QString &filePath) {
+    BMP_TRACE_SCOPE("probe");
+    ProbeInfo info;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return info;
+    }
+    info.fileSize = file.size();
+
+    // Nejdelší hlavičky i s celou 256barevnou paletou za nimi - paleta se
+    // dočítá zvlášť jen u nestandardně dlouhé hlavičky
+    const QByteArray head = file.read(MaxHeadersSize + 256 * 4);
+    if (!parseHeaders(reinterpret_cast<const uchar*>(head.constData()), head.size(),
+                      info.fileHeader, info.infoHeader)) {
+        return info;
+    }
+    info.valid = true;
+    info.supported = isSupported(info.infoHeader);
+
+    // Index v datech nemůže překročit 2^bitsPerPixel, delší paleta se nečte
+    const int bitsPerPixel = info.infoHeader.biBitCount;
+    if (bitsPerPixel >= 1 && bitsPerPixel <= 8) {
+        const qint64 maxColors = qint64(1) << bitsPerPixel;
+        const qint64 colors = info.infoHeader.biClrUsed > 0 ? qMin<qint64>(info.infoHeader.biClrUsed, maxColors)
+                                                            : maxColors;
+        const qint64 offset = paletteOffset(info.infoHeader);
+        QByteArray paletteData;
+        if (offset + colors * 4 <= head.size()) {
+            paletteData = head.mid(static_cast<int>(offset), static_cast<int>(colors * 4));
+        } else if (file.seek(offset)) {
+            paletteData = file.read(colors * 4);
+        }
+        const uchar *entry = reinterpret_cast<const uchar*>(paletteData.constData());
+        for (qint64 i = 0; i < colors && i*4 + 2 < paletteData.size(); i++) {
+            info.palette.append(qRgb(entry[i*4+2], entry[i*4+1], entry[i*4]));
+        }
+    }
+    return info;
+}
+
+bool Image::parseHeaders(const uchar *data, qint64 size, BMPFileHeader &parsedFileHeader, BMPInfoHeader &parsedInfoHeader) {
+    if (size < HeadersSize || data[0] != 'B' || data[1] != 'M') {
+        return false;
+    }
+
+    // Parsování file header (14 bajtů)
+    parsedFileHeader.bfType[0] = static_cast<char>(data[0]);
+    parsedFileHeader.bfType[1] = static_cast<char>(data[1]);
+    parsedFileHeader.bfSize = qFromLittleEndian<quint32>(data + 2);
+    parsedFileHeader.bfReserved1 = qFromLittleEndian<quint16>(data + 6);
+    parsedFileHeader.bfReserved2 = qFromLittleEndian<quint16>(data + 8);
+    parsedFileHeader.bfOffBits = qFromLittleEndian<quint32>(data + 10);
+
+    // Parsování info header (40 bajtů)
+    const uchar *info = data + FileHeaderSize;
+    parsedInfoHeader.biSize = qFromLittleEndian<quint32>(info + 0);
+    parsedInfoHeader.biWidth = qFromLittleEndian<qint32>(info + 4);
+    parsedInfoHeader.biHeight = qFromLittleEndian<qint32>(info + 8);
+    parsedInfoHeader.biPlanes = qFromLittleEndian<quint16>(info + 12);
+    parsedInfoHeader.biBitCount = qFromLittleEndian<quint16>(info + 14);
+    parsedInfoHeader.biCompression = qFromLittleEndian<quint32>(info + 16);
+    parsedInfoHeader.biSizeImage = qFromLittleEndian<quint32>(info + 20);
+    parsedInfoHeader.biXPelsPerMeter = qFromLittleEndian<qint32>(info + 24);
+    parsedInfoHeader.biYPelsPerMeter = qFromLittleEndian<qint32>(info + 28);
+    parsedInfoHeader.biClrUsed = qFromLittleEndian<quint32>(info + 32);
+    parsedInfoHeader.biClrImportant = qFromLittleEndian<quint32>(info + 36);
+
+    // Starší 12bajtová hlavička OS/2 má jiné rozložení
+    if (parsedInfoHeader.biSize < InfoHeaderSize) {
+        return false;
+    }
+
+    // Masky kanálů: hlavičky od 52 bajtů (V2 až V5) je obsahují přímo,
+    // u 40bajtové hlavičky s BI_BITFIELDS následují hned za ní
+    parsedInfoHeader.biRedMask = 0;
+    parsedInfoHeader.biGreenMask = 0;
+    parsedInfoHeader.biBlueMask = 0;
+    parsedInfoHeader.biAlphaMask = 0;
+    const quint32 compression = parsedInfoHeader.biCompression;
+    const bool masksInHeader = parsedInfoHeader.biSize >= 52;
+    if (masksInHeader || compression == BitFields::Bitfields || compression == BitFields::AlphaBitfields) {
+        const qint64 masksOffset = masksInHeader ? HeadersSize : FileHeaderSize + parsedInfoHeader.biSize;
+        const bool alphaMask = masksInHeader ? parsedInfoHeader.biSize >= 56 : compression == BitFields::AlphaBitfields;
+        if (size >= masksOffset + 12) {
+            parsedInfoHeader.biRedMask = qFromLittleEndian<quint32>(data + masksOffset);
+            parsedInfoHeader.biGreenMask = qFromLittleEndian<quint32>(data + masksOffset + 4);
+            parsedInfoHeader.biBlueMask = qFromLittleEndian<quint32>(data + masksOffset + 8);
+        }
+        if (alphaMask && size >= masksOffset + 16) {
+            parsedInfoHeader.biAlphaMask = qFromLittleEndian<quint32>(data + masksOffset + 12);
+        }
+    }
+
+    return true;
+}
+
+bool Image::saveToFile(const QString &filePath, const JobControl &control) const {
     // Kontrola, zda je obrázek prázdný
     if (isEmpty()) {
         return false;
     }
 
-    QFile file(filePath);
+    // Raw data lze zapsat přímo, pokud odpovídají pixelům (a mapování je stále platné)
+    const bool writeRawData = hasCurrentRawData();
+
+    // Obrázek větší než QByteArray se beze změny zapíše přímo z mapování
+    const bool writeMappedRows = !writeRawData && hasCurrentMappedRows();
+    if (!writeRawData && !writeMappedRows && hasTilesOnly()) {
+        return false;
+    }
+
+    // Ukládání přes zdrojový soubor: QSaveFile ho nahradí přejmenováním, na POSIX
+    // systémech tedy mapování dál ukazuje na původní (odpojený) soubor a zůstává
+    // platné - data se nekopírují. Windows namapovaný soubor nahradit nedovolí,
+    // tam se data z mapování musí nejdřív zkopírovat (řádky větší než QByteArray
+    // zkopírovat nelze, jejich uložení přes zdrojový soubor tam selže).
+#ifndef Q_OS_UNIX
+    if (mappedFile && !writeMappedRows && QFileInfo(filePath).canonicalFilePath() ==
+                                          QFileInfo(mappedFile->filePath()).canonicalFilePath()) {
+        releaseMapping(true);
+    }
+#endif
+
+    // Zapisuje se do dočasného souboru vedle cílového, commit() ho po fsync
+    // přejmenuje na cílový - zrušené nebo přerušené uložení (i pád programu)
+    // nechá cílový soubor netknutý. Bez commit() se dočasný soubor smaže.
+    QSaveFile file(filePath);
     if (!file.open(QIODevice::WriteOnly)) {
         return false;
     }
 
+    if (writeMappedRows) {
+        if (!writeMappedFile(file, control)) {
+            return false;
+        }
+    } else if (writeRawData || usesRleOnSave()) {
+        // Délka RLE dat není předem známá, kódují se proto celá předem
+        QByteArray encodedData;
+        if (!writeRawData && !encodePixels(encodedData, control)) {
+            return false;
+        }
+        quint32 compression = 0;
+        const QByteArray pixelData = compressRows(writeRawData ? rawData : encodedData, compression);
+
+        BMP_TRACE_SCOPE("write file");
+        if (!writeFile(file, pixelData, compression)) {
+            return false;
+        }
+    } else if (!writeEncodedFile(file, control)) {
+        return false;
+    }
+
+    BMP_TRACE_SCOPE("commit file");
+    return file.commit();
+}
+
+bool Image::saveToData(QByteArray &fileData, const JobControl &control) const {
+    if (isEmpty()) {
+        return false;
+    }
+
+    // Řádky větší než QByteArray se do QByteArray nevejdou
+    const bool writeRawData = hasCurrentRawData();
+    if (!writeRawData && hasTilesOnly()) {
+        return false;
+    }
+    QByteArray output;
+    QBuffer buffer(&output);
+    buffer.open(QIODevice::WriteOnly);
+
+    if (writeRawData || usesRleOnSave()) {
+        QByteArray encodedData;
+        if (!writeRawData && !encodePixels(encodedData, control)) {
+            return false;
+        }
+        quint32 compression = 0;
+        const QByteArray pixelData = compressRows(writeRawData ? rawData : encodedData, compression);
+        writeFile(buffer, pixelData, compression);
+    } else {
+        output.reserve(static_cast<int>(paletteOffset(infoHeader) + colorPalette.size() * 4 +
+                                        calculateRowSize() * imageHeight));
+        if (!writeEncodedFile(buffer, control)) {
+            return false;
+        }
+    }
+    buffer.close();
+    fileData = output;
+    return true;
+}
+
+bool Image::encodePixels(QByteArray &encodedData, const JobControl &control) const {
+    BMP_TRACE_SCOPE("encode");
+
+    // Výpočet velikosti řádku (musí být zarovnán na 4 bajty)
+    const qint64 bytesPerRow = calculateRowSize();
+    encodedData = QByteArray(static_cast<int>(bytesPerRow * imageHeight), 0);
+    BMP_TRACE_BYTES(encodedData.size());
+
+    // Indexy se kopírují bez hledání v paletě - kodér pak paletu nepotřebuje
+    const QImage source = encoderSource();
+    const RowEncoder encoder(imageBitsPerPixel, imageWidth, hasIndexedPixels() ? QVector<QRgb>() : colorPalette,
+                             channelMasks(infoHeader));
+    control.beginProgress(imageHeight);
+    encodeRows(0, imageHeight, source, encoder, reinterpret_cast<uchar*>(encodedData.data()), control);
+    return !control.isCanceled();
+}
+
+QImage Image::encoderSource() const {
+    // Obrázek s paletou uložený jako indexy se zapíše beze změny, ostatní
+    // kodéry pracují přímo nad 32bitovými řádky QImage
+    if (hasIndexedPixels() || qImage.format() == QImage::Format_RGB32 || qImage.format() == QImage::Format_ARGB32) {
+        return qImage;
+    }
+    return qImage.convertToFormat(QImage::Format_ARGB32);
+}
+
+void Image::encodeRows(int firstRow, int endRow, const QImage &source, const RowEncoder &encoder, uchar *output,
+                       const JobControl &control) const {
+    const qint64 bytesPerRow = calculateRowSize();
+    const bool bottomUp = infoHeader.biHeight > 0;
+    const bool indexed = source.format() == QImage::Format_Mono || source.format() == QImage::Format_Indexed8;
+
+    // Po úpravě jen části obrázku se nezměněné řádky zkopírují z původních
+    // dat - převod (u palety hledání nejbližší barvy) se týká jen změněných řádků
+    const bool partial = !indexed && rawDataValid && !dirtyRows.isEmpty() &&
+                         rawData.size() >= bytesPerRow * imageHeight;
+    const uchar *original = reinterpret_cast<const uchar*>(rawData.constData());
+
+    // Řádky jsou nezávislé, takže se kódují paralelně po pásech
+    ParallelRows::forEachBand(endRow - firstRow, bytesPerRow, [&](int bandFirst, int bandEnd) {
+        if (control.isCanceled()) return;
+        for (int offset = bandFirst; offset < bandEnd; offset++) {
+            // Řádek obrázku (BMP ukládá data odspodu nahoru, pokud biHeight > 0)
+            const int row = firstRow + offset;
+            const int y = bottomUp ? imageHeight - 1 - row : row;
+            uchar *target = output + offset * bytesPerRow;
+            if (indexed) {
+                RowEncoder::encodeIndices(source.constScanLine(y), imageBitsPerPixel, imageWidth, target);
+            } else if (partial && !dirtyRows.testBit(y)) {
+                memcpy(target, original + row * bytesPerRow, static_cast<size_t>(bytesPerRow));
+            } else {
+                encoder.encodeRow(reinterpret_cast<const QRgb*>(source.constScanLine(y)), target);
+            }
+        }
+        control.addProgress(bandEnd - bandFirst);
+    });
+}
+
+bool Image::usesRleOnSave() const {
+    // RLE umí jen 4 a 8 bitů na pixel a jen řádky uložené odspodu nahoru
+    return compressionOnSave == Compression::RleIfSmaller && RleCodec::compressionFor(imageBitsPerPixel) != 0 &&
+           infoHeader.biHeight > 0;
+}
+
+QByteArray Image::compressRows(const QByteArray &rows, quint32 &compression) const {
+    compression = 0;
+    if (!usesRleOnSave()) {
+        return rows;
+    }
+
+    BMP_TRACE_SCOPE("encode rle");
+    const QByteArray compressed = RleCodec::encode(rows, imageBitsPerPixel, imageWidth, imageHeight);
+    if (compressed.size() >= rows.size()) {
+        return rows;
+    }
+    compression = RleCodec::compressionFor(imageBitsPerPixel);
+    return compressed;
+}
+
+bool Image::writeFile(QIODevice &device, const QByteArray &pixelData, quint32 compression) const {
+    // 1.-3. Zápis hlaviček a palety
+    BMPFileHeader saveFileHeader;
+    BMPInfoHeader saveInfoHeader;
+    headersForSave(pixelData.size(), compression, saveFileHeader, saveInfoHeader);
+    if (!writeHeaders(device, saveFileHeader, saveInfoHeader,
+                      imageBitsPerPixel <= 8 ? colorPalette : QVector<QRgb>())) {
+        return false;
+    }
+
+    // 4. Zápis obrazových dat - raw data, pokud je filtry nezměnily nebo upravily přímo
+    return device.write(pixelData) == pixelData.size();
+}
+
+bool Image::writeEncodedFile(QIODevice &device, const JobControl &control) const {
+    const qint64 bytesPerRow = calculateRowSize();
+    BMPFileHeader saveFileHeader;
+    BMPInfoHeader saveInfoHeader;
+    headersForSave(bytesPerRow * imageHeight, 0, saveFileHeader, saveInfoHeader);
+    if (!writeHeaders(device, saveFileHeader, saveInfoHeader,
+                      imageBitsPerPixel <= 8 ? colorPalette : QVector<QRgb>())) {
+        return false;
+    }
+
+    BMP_TRACE_SCOPE("encode and write");
+    BMP_TRACE_BYTES(bytesPerRow * imageHeight);
+    const QImage source = encoderSource();
+    const RowEncoder encoder(imageBitsPerPixel, imageWidth, hasIndexedPixels() ? QVector<QRgb>() : colorPalette,
+                             channelMasks(infoHeader));
+
+    // Pásy v pořadí souboru: další pás se kóduje, zatímco se předchozí zapisuje
+    const int bandRows = static_cast<int>(qBound<qint64>(1, WriteBandBytes / bytesPerRow, imageHeight));
+    BandWriter writer(device, bandRows * bytesPerRow, bandRows < imageHeight);
+    control.beginProgress(imageHeight);
+    for (int firstRow = 0; firstRow < imageHeight && !control.isCanceled(); firstRow += bandRows) {
+        const int endRow = qMin(firstRow + bandRows, imageHeight);
+        const qint64 bandBytes = (endRow - firstRow) * bytesPerRow;
+        uchar *band = writer.nextBuffer();
+        memset(band, 0, static_cast<size_t>(bandBytes));
+        encodeRows(firstRow, endRow, source, encoder, band, control);
+        writer.submit(bandBytes);
+    }
+    return writer.finish() && !control.isCanceled();
+}
+
+bool Image::writeMappedFile(QIODevice &device, const JobControl &control) const {
+    const qint64 pixelBytes = mappedFile->size() - mappedRowsOffset;
+    BMPFileHeader saveFileHeader;
+    BMPInfoHeader saveInfoHeader;
+    headersForSave(pixelBytes, 0, saveFileHeader, saveInfoHeader);
+    if (!writeHeaders(device, saveFileHeader, saveInfoHeader,
+                      imageBitsPerPixel <= 8 ? colorPalette : QVector<QRgb>())) {
+        return false;
+    }
+
+    BMP_TRACE_SCOPE("write mapped rows");
+    BMP_TRACE_BYTES(pixelBytes);
+    // Mapování se drží po celou dobu zápisu (releaseMapping ho může uvolnit)
+    const std::shared_ptr<MappedFile> mapping = mappedFile;
+    const char *rows = reinterpret_cast<const char*>(mapping->data() + mappedRowsOffset);
+    control.beginProgress(pixelBytes / WriteBandBytes + 1);
+    for (qint64 written = 0; written < pixelBytes; written += WriteBandBytes) {
+        if (control.isCanceled()) {
+            return false;
+        }
+        const qint64 bandBytes = qMin(WriteBandBytes, pixelBytes - written);
+        if (device.write(rows + written, bandBytes) != bandBytes) {
+            return false;
+        }
+        control.addProgress(1);
+    }
+    return true;
+}
+
+bool Image::writeHeaders(QIODevice &output, const BMPFileHeader &fileHeaderOut, const BMPInfoHeader &infoHeaderOut,
+                         const QVector<QRgb> &palette) {
+    // Hlavičky a paleta se skládají v paměti a zapíšou najednou
+    QByteArray headers;
+    headers.reserve(static_cast<int>(paletteOffset(infoHeaderOut) + palette.size() * 4));
+    QBuffer device(&headers);
+    device.open(QIODevice::WriteOnly);
+
     // 1. Zápis file header (14 bajtů)
-    file.write(fileHeader.bfType, 2);
-    file.write(reinterpret_cast<const char*>(&fileHeader.bfSize), 4);
-    file.write(reinterpret_cast<const char*>(&fileHeader.bfReserved1), 2);
-    file.write(reinterpret_cast<const char*>(&fileHeader.bfReserved2), 2);
-    file.write(reinterpret_cast<const char*>(&fileHeader.bfOffBits), 4);
+    device.write(fileHeaderOut.bfType, 2);
+    device.write(reinterpret_cast<const char*>(&fileHeaderOut.bfSize), 4);
+    device.write(reinterpret_cast<const char*>(&fileHeaderOut.bfReserved1), 2);
+    device.write(reinterpret_cast<const char*>(&fileHeaderOut.bfReserved2), 2);
+    device.write(reinterpret_cast<const char*>(&fileHeaderOut.bfOffBits), 4);
 
     // 2. Zápis info header (40 bajtů)
-    file.write(reinterpret_cast<const char*>(&infoHeader.biSize), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biWidth), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biHeight), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biPlanes), 2);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biBitCount), 2);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biCompression), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biSizeImage), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biXPelsPerMeter), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biYPelsPerMeter), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biClrUsed), 4);
-    file.write(reinterpret_cast<const char*>(&infoHeader.biClrImportant), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biSize), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biWidth), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biHeight), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biPlanes), 2);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biBitCount), 2);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biCompression), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biSizeImage), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biXPelsPerMeter), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biYPelsPerMeter), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biClrUsed), 4);
+    device.write(reinterpret_cast<const char*>(&infoHeaderOut.biClrImportant), 4);
+
+    // Masky kanálů: v hlavičce V4/V5, u 40bajtové hlavičky hned za ní
+    if (infoHeaderOut.biSize >= V4HeaderSize) {
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biRedMask), 4);
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biGreenMask), 4);
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biBlueMask), 4);
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biAlphaMask), 4);
+        const quint32 colorSpace = 0x73524742;  // LCS_sRGB ('sRGB') - koncové body a gama se nepoužívají
+        device.write(reinterpret_cast<const char*>(&colorSpace), 4);
+        device.write(QByteArray(36 + 12, '\0'));
+        if (infoHeaderOut.biSize >= V5HeaderSize) {
+            const quint32 intent = 4;  // LCS_GM_IMAGES, bez vloženého profilu
+            device.write(reinterpret_cast<const char*>(&intent), 4);
+            device.write(QByteArray(12, '\0'));
+        }
+    } else if (infoHeaderOut.biCompression == BitFields::Bitfields ||
+               infoHeaderOut.biCompression == BitFields::AlphaBitfields) {
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biRedMask), 4);
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biGreenMask), 4);
+        device.write(reinterpret_cast<const char*>(&infoHeaderOut.biBlueMask), 4);
+        if (infoHeaderOut.biCompression == BitFields::AlphaBitfields) {
+            device.write(reinterpret_cast<const char*>(&infoHeaderOut.biAlphaMask), 4);
+        }
+    }
 
     // 3. Zápis palety barev (pokud existuje)
-    if (imageBitsPerPixel <= 8 && !colorPalette.isEmpty()) {
-        for (QRgb color : colorPalette) {
+    if (!palette.isEmpty()) {
+        for (QRgb color : palette) {
             char paletteEntry[4];
             paletteEntry[0] = static_cast<char>(qBlue(color));  // B
             paletteEntry[1] = static_cast<char>(qGreen(color)); // G
             paletteEntry[2] = static_cast<char>(qRed(color));   // R
             paletteEntry[3] = 0; // Reserved
-            file.write(paletteEntry, 4);
-        }
-    }
-
-    // 4. Zápis obrazových dat
-    if (modified) {
-        // Výpočet velikosti řádku (musí být zarovnán na 4 bajty)
-        int bytesPerRow = calculateRowSize();
-        QByteArray dataToSave(bytesPerRow * imageHeight, 0);
-
-        // Konverze pixelů z QImage zpět do formátu BMP
-        for (int y = 0; y < qImage.height(); y++) {
-            for (int x = 0; x < qImage.width(); x++) {
-                QRgb pixel = qImage.pixel(x, y);
-
-                // Pozice v datech (BMP ukládá data odspodu nahoru, pokud biHeight > 0)
-                int row = (infoHeader.biHeight > 0) ? imageHeight - 1 - y : y;
-                int byteIndex = row * bytesPerRow;
-
-                if (imageBitsPerPixel == 24) {
-                    // 24 bitů = 3 bajty na pixel
-                    int index = byteIndex + x * 3;
-                    if (index + 2 < dataToSave.size()) {
-                        dataToSave[index] = static_cast<char>(qBlue(pixel));
-                        dataToSave[index + 1] = static_cast<char>(qGreen(pixel));
-                        dataToSave[index + 2] = static_cast<char>(qRed(pixel));
-                    }
-                }
-                else if (imageBitsPerPixel == 8) {
-                    // 8 bitů = 1 bajt na pixel
-                    int index = byteIndex + x;
-                    if (index < dataToSave.size()) {
-                        // Nalezení nejbližší barvy v paletě
-                        QRgb currentPixel = pixel;
-                        int bestMatch = 0;
-                        int bestDiff = INT_MAX;
-
-                        for (int i = 0; i < colorPalette.size(); i++) {
-                            QRgb paletteColor = colorPalette[i];
-                            int rDiff = qRed(currentPixel) - qRed(paletteColor);
-                            int gDiff = qGreen(currentPixel) - qGreen(paletteColor);
-                            int bDiff = qBlue(currentPixel) - qBlue(paletteColor);
-
-                            // Výpočet vzdálenosti v RGB prostoru
-                            int diff = rDiff * rDiff + gDiff * gDiff + bDiff * bDiff;
-
-                            if (diff < bestDiff) {
-                                bestDiff = diff;
-                                bestMatch = i;
-                            }
-                        }
-
-                        dataToSave[index] = static_cast<char>(bestMatch);
-                    }
-                }
-                else if (imageBitsPerPixel == 4) {
-                    // 4 bity = 2 pixely na bajt
-                    int bytePos = byteIndex + x / 2;
-                    if (bytePos < dataToSave.size()) {
-                        // Nalezení nejbližší barvy v paletě
-                        QRgb currentPixel = pixel;
-                        int bestMatch = 0;
-                        int bestDiff = INT_MAX;
-
-                        for (int i = 0; i < colorPalette.size() && i < 16; i++) {
-                            QRgb paletteColor = colorPalette[i];
-                            int rDiff = qRed(currentPixel) - qRed(paletteColor);
-                            int gDiff = qGreen(currentPixel) - qGreen(paletteColor);
-                            int bDiff = qBlue(currentPixel) - qBlue(paletteColor);
-
-                            int diff = rDiff * rDiff + gDiff * gDiff + bDiff * bDiff;
-
-                            if (diff < bestDiff) {
-                                bestDiff = diff;
-                                bestMatch = i;
-                            }
-                        }
-
-                        // Aktualizace hodnoty v bajtu
-                        unsigned char currentByte = static_cast<unsigned char>(dataToSave[bytePos]);
-                        if (x % 2 == 0) {
-                            // Horní 4 bity (první pixel v bajtu)
-                            currentByte = (currentByte & 0x0F) | (bestMatch << 4);
-                        } else {
-                            // Dolní 4 bity (druhý pixel v bajtu)
-                            currentByte = (currentByte & 0xF0) | bestMatch;
-                        }
-                        dataToSave[bytePos] = static_cast<char>(currentByte);
-                    }
-                }
-                else if (imageBitsPerPixel == 1) {
-                    // 1 bit = 8 pixelů na bajt
-                    int bytePos = byteIndex + x / 8;
-                    if (bytePos < dataToSave.size()) {
-                        // Pro 1-bitový obrázek máme jen 2 barvy (obvykle černá a bílá)
-                        QRgb currentPixel = pixel;
-                        int bestMatch = 0;
-
-                        // Máme jen dvě barvy, takže stačí porovnat s první
-                        if (colorPalette.size() >= 2) {
-                            QRgb color0 = colorPalette[0];
-                            QRgb color1 = colorPalette[1];
-
-                            int rDiff0 = qRed(currentPixel) - qRed(color0);
-                            int gDiff0 = qGreen(currentPixel) - qGreen(color0);
-                            int bDiff0 = qBlue(currentPixel) - qBlue(color0);
-
-                            int rDiff1 = qRed(currentPixel) - qRed(color1);
-                            int gDiff1 = qGreen(currentPixel) - qGreen(color1);
-                            int bDiff1 = qBlue(currentPixel) - qBlue(color1);
-
-                            int diff0 = rDiff0 * rDiff0 + gDiff0 * gDiff0 + bDiff0 * bDiff0;
-                            int diff1 = rDiff1 * rDiff1 + gDiff1 * gDiff1 + bDiff1 * bDiff1;
-
-                            bestMatch = (diff1 < diff0) ? 1 : 0;
-                        }
-
-                        // Určíme, který bit v bajtu aktualizujeme
-                        int bitPos = 7 - (x % 8); // 7, 6, 5, 4, 3, 2, 1, 0
-
-                        unsigned char currentByte = static_cast<unsigned char>(dataToSave[bytePos]);
-                        if (bestMatch == 0) {
-                            // Nastavíme bit na 0
-                            currentByte &= ~(1 << bitPos);
-                        } else {
-                            // Nastavíme bit na 1
-                            currentByte |= (1 << bitPos);
-                        }
-                        dataToSave[bytePos] = static_cast<char>(currentByte);
-                    }
-                }
-            }
+            device.write(paletteEntry, 4);
+        }
+    }
+
+    device.close();
+    return output.write(headers) == headers.size();
+}
+
+bool Image::isSupported(const BMPInfoHeader &header) {
+    if (header.biBitCount != 1 && header.biBitCount != 4 && header.biBitCount != 8 &&
+        header.biBitCount != 16 && header.biBitCount != 24 && header.biBitCount != 32) {
+        return false;
+    }
+
+    switch (header.biCompression) {
+        case 0:
+            return true;
+        case RleCodec::Rle8:
+        case RleCodec::Rle4:
+            // BI_RLE8 jen pro 8 bitů, BI_RLE4 jen pro 4 bity; komprimovaný obrázek je vždy odspodu nahoru
+            return header.biCompression == RleCodec::compressionFor(header.biBitCount) && header.biHeight > 0;
+        case BitFields::Bitfields:
+        case BitFields::AlphaBitfields:
+            return channelMasks(header).isValid(header.biBitCount);
+        default:
+            return false;
+    }
+}
+
+BitFields Image::channelMasks(const BMPInfoHeader &header) {
+    if (header.biCompression == BitFields::Bitfields || header.biCompression == BitFields::AlphaBitfields) {
+        return {header.biRedMask, header.biGreenMask, header.biBlueMask, header.biAlphaMask};
+    }
+    return BitFields::defaults(header.biBitCount);
+}
+
+qint64 Image::paletteOffset(const BMPInfoHeader &header) {
+    qint64 offset = FileHeaderSize + header.biSize;
+    if (header.biSize < 52) {
+        if (header.biCompression == BitFields::Bitfields) {
+            offset += 12;
+        } else if (header.biCompression == BitFields::AlphaBitfields) {
+            offset += 16;
+        }
+    }
+    return offset;
+}
+
+void Image::prepareInfoHeader(BMPInfoHeader &header, quint32 compression) {
+    const BitFields masks = channelMasks(header);
+    header.biSize = InfoHeaderSize;
+    header.biCompression = compression;
+
+    // Masky odpovídající BI_RGB se nezapisují; alfa kanál potřebuje hlavičku V4
+    // (BI_ALPHABITFIELDS čte jen málokterý program)
+    if (masks != BitFields::defaults(header.biBitCount)) {
+        header.biCompression = BitFields::Bitfields;
+        header.biRedMask = masks.red;
+        header.biGreenMask = masks.green;
+        header.biBlueMask = masks.blue;
+        header.biAlphaMask = masks.alpha;
+        if (masks.hasAlpha()) {
+            header.biSize = V4HeaderSize;
+        }
+    }
+}
+
+bool Image::hasIndexedPixels() const {
+    if (imageBitsPerPixel == 1) {
+        return qImage.format() == QImage::Format_Mono;
+    }
+    return imageBitsPerPixel <= 8 && qImage.format() == QImage::Format_Indexed8;
+}
+
+void Image::discardRawData() {
+    // Řádky se případně znovu sestaví z pixelů (encodePixels) až při uložení
+    rawData = QByteArray();
+    rawDataValid = false;
+    dirtyRows = QBitArray();
+    mappedFile.reset();
+}
+
+void Image::markRowsDirty(int firstRow, int endRow) {
+    // Bez původních řádků se při uložení stejně kóduje celý obrázek
+    if (!rawDataValid || rawData.isEmpty()) {
+        return;
+    }
+    if (dirtyRows.isEmpty()) {
+        dirtyRows = QBitArray(imageHeight);
+    }
+    dirtyRows.fill(true, firstRow, endRow);
+}
+
+bool Image::hasCurrentRawData() const {
+    // Zdrojový soubor mohl být mezitím přepsán - namapovaná data už pak neplatí.
+    // Obrázek po dlaždicích jiná data nemá; jeho dlaždice změnu odhalí samy
+    // a dál se nedekódují (TiledImageStore::isSourceLost)
+    if (mappedFile && !mappedFile->isUnchanged()) {
+        releaseMapping(false);
+    }
+    return rawDataValid && !rawData.isEmpty() && dirtyRows.isEmpty();
+}
+
+void Image::releaseMapping(bool keepData) const {
+    if (keepData) {
+        rawData = QByteArray(rawData.constData(), rawData.size());
+        // Dlaždice se dál dekódují z kopie (sdílí ji i zobrazení)
+        if (tileStore) {
+            tileStore->replaceRows(rawData);
         }
-        file.write(dataToSave);
     } else {
-        // Použití původních dat, pokud obrázek nebyl upraven
-        file.write(rawData);
+        rawData.clear();
     }
+    mappedFile.reset();
+}
 
-    file.close();
-    return true;
+qint64 Image::calculateRowSize() const {
+    return calculateRowSize(imageWidth, imageBitsPerPixel);
 }
 
-int Image::calculateRowSize() const {
-    return ((imageWidth * imageBitsPerPixel + 31) / 32) * 4;
+qint64 Image::calculateRowSize(int width, int bitsPerPixel) {
+    // 64bitový výpočet - u obřích obrázků by int přetekl
+    return ((static_cast<qint64>(width) * bitsPerPixel + 31) / 32) * 4;
 }
 
 const Image::BMPFileHeader & Image::getFileHeader() const {
@@ -285,90 +736,448 @@ const Image::BMPInfoHeader & Image::getInfoHeader() const {
     return infoHeader;
 }
 
-void Image::renderFromRawData() {
-    // Vytvoření prázdného obrázku
-    qImage = QImage(imageWidth, imageHeight, QImage::Format_RGB32);
-    int bytesPerRow = calculateRowSize();
+void Image::renderFromRawData(const JobControl &control, bool publishPreview) {
+    qImage = decodeRows(rawData, imageWidth, imageHeight, imageBitsPerPixel, colorPalette, channelMasks(infoHeader),
+                        infoHeader.biHeight > 0, control, publishPreview);
+}
+
+QImage Image::decodeRows(const QByteArray &rows, int width, int height, int bitsPerPixel,
+                         const QVector<QRgb> &palette, const BitFields &masks, bool bottomUp,
+                         const JobControl &control, bool publishPreview) {
+    BMP_TRACE_SCOPE("decode");
 
-    // Vykreslení podle bitové hloubky
-    for (int y = 0; y < imageHeight; y++) {
-        for (int x = 0; x < imageWidth; x++) {
-            QRgb pixelColor;
+    // Kernel pro bitovou hloubku se vybere jednou pro celý obrázek
+    const RowDecoder decoder(bitsPerPixel, width, palette, masks);
 
+    const qint64 bytesPerRow = calculateRowSize(width, bitsPerPixel);
+    const uchar *data = reinterpret_cast<const uchar*>(rows.constData());
+    const qint64 dataSize = rows.size();
+
+    // Obrázek s paletou zůstane jako indexy s tabulkou barev (1 bit Format_Mono,
+    // 4 a 8 bitů Format_Indexed8) - v paměti je tak 4x až 32x menší než 32bitové
+    // pixely. Zkrácená data se dekódují do 32 bitů, aby chybějící pixely zůstaly černé.
+    const bool indexed = bitsPerPixel <= 8 && dataSize >= bytesPerRow * height;
+    QImage::Format format = decoder.hasAlpha() ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    if (indexed) {
+        format = (bitsPerPixel == 1) ? QImage::Format_Mono : QImage::Format_Indexed8;
+    }
+
+    // Vytvoření prázdného obrázku (s alfa kanálem jen pro 16/32 bitů s maskou alfy)
+    QImage result(width, height, format);
+    if (result.isNull()) {
+        return result;
+    }
+    if (indexed) {
+        result.setColorTable(colorTableFor(palette, bitsPerPixel));
+    }
+    BMP_TRACE_BYTES(qint64(result.bytesPerLine()) * height);
+
+    uchar *bits = result.bits();
+    const qint64 bytesPerLine = result.bytesPerLine();
+
+    // Pásy dokončené mimo pořadí; zveřejňuje se jen souvislý začátek obrázku
+    publishPreview = publishPreview && control.wantsPreview();
+    QMutex readyMutex;
+    QMap<int, int> finishedBands;  // první řádek -> konec pásu
+    int readyRows = 0;
+
+    // Řádky jsou nezávislé - dekódují se paralelně po pásech
+    control.beginProgress(height);
+    ParallelRows::forEachBand(height, bytesPerLine, [&](int firstRow, int endRow) {
+        if (control.isCanceled()) return;
+        for (int y = firstRow; y < endRow; y++) {
             // Pozice v datech (BMP ukládá data odspodu nahoru, pokud biHeight > 0)
-            int row = (infoHeader.biHeight > 0) ? imageHeight - 1 - y : y;
-            int byteIndex = row * bytesPerRow;
-
-            if (imageBitsPerPixel == 24) {
-                // 24 bitů = 3 bajty na pixel
-                int index = byteIndex + x * 3;
-                if (index + 2 < rawData.size()) {
-                    int blue = static_cast<unsigned char>(rawData[index]);
-                    int green = static_cast<unsigned char>(rawData[index + 1]);
-                    int red = static_cast<unsigned char>(rawData[index + 2]);
-                    pixelColor = qRgb(red, green, blue);
-                } else {
-                    pixelColor = qRgb(0, 0, 0);
-                }
+            int row = bottomUp ? height - 1 - y : y;
+            qint64 offset = row * bytesPerRow;
+            qint64 available = dataSize - offset;
+
+            uchar *line = bits + y * bytesPerLine;
+            if (indexed) {
+                RowDecoder::decodeIndices(data + offset, bitsPerPixel, width, line);
+            } else {
+                decoder.decodeRow(available > 0 ? data + offset : nullptr, available, reinterpret_cast<QRgb*>(line));
             }
-            else if (imageBitsPerPixel == 8) {
-                // 8 bitů = 1 bajt na pixel
-                int index = byteIndex + x;
-                if (index < rawData.size()) {
-                    int colorIndex = static_cast<unsigned char>(rawData[index]);
-                    pixelColor = colorPalette.value(colorIndex, qRgb(0, 0, 0));
-                } else {
-                    pixelColor = qRgb(0, 0, 0);
-                }
+        }
+        control.addProgress(endRow - firstRow);
+
+        if (publishPreview) {
+            QMutexLocker locker(&readyMutex);
+            finishedBands.insert(firstRow, endRow);
+            while (finishedBands.contains(readyRows)) {
+                readyRows = finishedBands.take(readyRows);
             }
-            else if (imageBitsPerPixel == 4) {
-                // 4 bity = 2 pixely na bajt
-                int index = byteIndex + x / 2;
-                if (index < rawData.size()) {
-                    int value = static_cast<unsigned char>(rawData[index]);
-                    int colorIndex;
-                    if (x % 2 == 0) {
-                        // Horní 4 bity
-                        colorIndex = (value >> 4) & 0x0F;
-                    } else {
-                        // Dolní 4 bity
-                        colorIndex = value & 0x0F;
-                    }
-                    pixelColor = colorPalette.value(colorIndex, qRgb(0, 0, 0));
-                } else {
-                    pixelColor = qRgb(0, 0, 0);
-                }
+            control.publishPreview(result, readyRows);
+        }
+    });
+    return result;
+}
+
+std::shared_ptr<TiledImageStore> Image::createTileStore() const {
+    // Dokud rawData ukazují do mapování, dlaždice čtou přímo z něj
+    if (mappedFile) {
+        return std::make_shared<TiledImageStore>(mappedFile, mappedRowsOffset, mappedFile->size() - mappedRowsOffset,
+                                                 imageWidth, imageHeight, imageBitsPerPixel, colorPalette,
+                                                 channelMasks(infoHeader), infoHeader.biHeight > 0);
+    }
+    return std::make_shared<TiledImageStore>(rawData, imageWidth, imageHeight, imageBitsPerPixel, colorPalette,
+                                             channelMasks(infoHeader), infoHeader.biHeight > 0);
+}
+
+bool Image::hasTilesOnly() const {
+    return tileStore && rawData.isEmpty();
+}
+
+bool Image::hasCurrentMappedRows() const {
+    return hasTilesOnly() && mappedFile && rawDataValid && dirtyRows.isEmpty() && mappedFile->isUnchanged();
+}
+
+bool Image::applyFilter(const Filter &filter, const JobControl &control) {
+    // Filtru s přesnou inverzí stačí zapamatovat inverzi, jinak se ještě
+    // před úpravou uloží komprimovaný snímek současného stavu
+    UndoHistory::Step step;
+    if (history.isEnabled()) {
+        step.filter = filter.inverse();
+        if (!step.filter) {
+            step = snapshotStep();
+        }
+        step.name = filter.name();
+        step.modified = modified;
+    }
+
+    if (!applyWithoutHistory(filter, control)) {
+        return false;
+    }
+    history.push(step);
+    return true;
+}
+
+bool Image::applyFilter(const Filter &filter, const QRect &region, const JobControl &control) {
+    const QRect bounds(0, 0, imageWidth, imageHeight);
+    const QRect area = region.intersected(bounds);
+    if (area.isEmpty()) {
+        return false;
+    }
+    if (area == bounds) {
+        return applyFilter(filter, control);
+    }
+
+    // Do historie stačí inverze na stejné oblasti, jinak původní pixely oblasti
+    UndoHistory::Step step;
+    if (history.isEnabled()) {
+        step.filter = filter.inverse();
+        if (!step.filter) {
+            step.pixels = UndoHistory::Pixels::compress(regionPixels(area));
+        }
+        step.region = area;
+        step.name = filter.name();
+        step.modified = modified;
+    }
+
+    if (!applyToRegion(filter, area, control)) {
+        return false;
+    }
+    history.push(step);
+    return true;
+}
+
+bool Image::applyToRegion(const Filter &filter, const QRect &region, const JobControl &control) {
+    BMP_TRACE_SCOPE_NAME("filter " + filter.name() + " (region)");
+    // Vložení výsledku dekóduje obrázek celý (viz pasteRegion)
+    if (hasTilesOnly()) {
+        return false;
+    }
+
+    const QImage patch = filter.applyCancellable(regionPixels(region), control);
+    if (control.isCanceled()) {
+        return false;
+    }
+    // Filtr, který mění rozměry (např. otočení obdélníku), na oblast použít nelze
+    if (patch.size() != region.size()) {
+        return false;
+    }
+    BMP_TRACE_BYTES(qint64(patch.bytesPerLine()) * patch.height());
+    pasteRegion(patch, region.topLeft());
+    return !control.isCanceled();
+}
+
+QImage Image::regionPixels(const QRect &region) const {
+    if (tileStore) {
+        return tileStore->copy(region);
+    }
+    const QImage pixels = qImage.copy(region);
+    if (pixels.format() == QImage::Format_RGB32 || pixels.format() == QImage::Format_ARGB32) {
+        return pixels;
+    }
+    return pixels.convertToFormat(pixels.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+void Image::pasteRegion(const QImage &patch, const QPoint &position) {
+    if (tileStore) {
+        renderFromRawData();
+        tileStore.reset();
+    }
+
+    // Nezměněné řádky se při uložení zkopírují z rawData - u indexů, jejichž
+    // řádky už byly uvolněny, se nejdřív přesně sestaví znovu
+    if (hasIndexedPixels() && !hasCurrentRawData() && dirtyRows.isEmpty()) {
+        QByteArray rows;
+        if (encodePixels(rows, JobControl::none())) {
+            rawData = rows;
+            rawDataValid = true;
+            mappedFile.reset();
+        }
+    }
+
+    // Upravené pixely už nemusí být v paletě - obrázek přejde na 32 bitů
+    QImage pixels = qImage;
+    if (pixels.format() != QImage::Format_RGB32 && pixels.format() != QImage::Format_ARGB32) {
+        pixels = pixels.convertToFormat(pixels.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    const QImage source = (patch.format() == pixels.format()) ? patch : patch.convertToFormat(pixels.format());
+    const size_t rowBytes = static_cast<size_t>(source.width()) * sizeof(QRgb);
+    for (int y = 0; y < source.height(); y++) {
+        memcpy(pixels.scanLine(position.y() + y) + position.x() * sizeof(QRgb), source.constScanLine(y), rowBytes);
+    }
+    qImage = pixels;
+
+    const QRect changed(position, source.size());
+    markRowsDirty(changed.top(), changed.bottom() + 1);
+    modified = true;
+    if (mipPyramid) {
+        mipPyramid = mipPyramid->derive(changed, qImage);
+    }
+}
+
+bool Image::undo(const JobControl &control) {
+    if (!history.canUndo()) {
+        return false;
+    }
+    const UndoHistory::Step step = history.undoStep();
+    UndoHistory::Step opposite;
+    if (!performStep(step, opposite, control)) {
+        return false;
+    }
+    history.undone(opposite);
+    return true;
+}
+
+bool Image::redo(const JobControl &control) {
+    if (!history.canRedo()) {
+        return false;
+    }
+    const UndoHistory::Step step = history.redoStep();
+    UndoHistory::Step opposite;
+    if (!performStep(step, opposite, control)) {
+        return false;
+    }
+    history.redone(opposite);
+    return true;
+}
+
+bool Image::performStep(const UndoHistory::Step &step, UndoHistory::Step &opposite, const JobControl &control) {
+    const bool currentModified = modified;
+    if (step.filter) {
+        // Inverze inverze je původní filtr - pro znovu se opět neukládají pixely
+        const bool applied = step.region.isValid() ? applyToRegion(*step.filter, step.region, control)
+                                                   : applyWithoutHistory(*step.filter, control);
+        if (!applied) {
+            return false;
+        }
+        opposite.filter = step.filter->inverse();
+    } else if (step.region.isValid()) {
+        opposite.pixels = UndoHistory::Pixels::compress(regionPixels(step.region));
+        pasteRegion(step.pixels.decompress(), step.region.topLeft());
+    } else {
+        opposite = snapshotStep();
+        restoreSnapshot(step);
+    }
+    opposite.region = step.region;
+    opposite.name = step.name;
+    opposite.modified = currentModified;
+    modified = step.modified;
+    return true;
+}
+
+UndoHistory::Step Image::snapshotStep() const {
+    BMP_TRACE_SCOPE("undo snapshot");
+    std::shared_ptr<Image> state = std::make_shared<Image>(*this);
+    state->qImage = QImage();
+    state->mipPyramid.reset();
+    state->tileStore.reset();
+    state->history.clear();
+    // Řádky BMP vedle pixelů jsou navíc (při uložení se zakódují znovu);
+    // obrázek po dlaždicích je naopak potřebuje a pohled do mapování nic nestojí
+    if (!tileStore && !mappedFile) {
+        state->discardRawData();
+    }
+
+    UndoHistory::Step step;
+    step.state = state;
+    step.pixels = UndoHistory::Pixels::compress(qImage);
+    return step;
+}
+
+void Image::restoreSnapshot(const UndoHistory::Step &step) {
+    // Historie a nastavení ukládání patří k obrázku, ne ke stavu
+    const UndoHistory keptHistory = history;
+    const Compression keptCompression = compressionOnSave;
+    *this = *step.state;
+    history = keptHistory;
+    compressionOnSave = keptCompression;
+
+    qImage = step.pixels.decompress();
+    if (qImage.isNull() && (!rawData.isEmpty() || mappedFile)) {
+        tileStore = createTileStore();
+    }
+}
+
+bool Image::canUndo() const {
+    return history.canUndo();
+}
+
+bool Image::canRedo() const {
+    return history.canRedo();
+}
+
+QString Image::undoName() const {
+    return history.canUndo() ? history.undoStep().name : QString();
+}
+
+QString Image::redoName() const {
+    return history.canRedo() ? history.redoStep().name : QString();
+}
+
+void Image::setUndoBudget(qint64 bytes) {
+    history.setBudget(bytes);
+}
+
+bool Image::applyWithoutHistory(const Filter &filter, const JobControl &control) {
+    BMP_TRACE_SCOPE_NAME("filter " + filter.name());
+
+    // Obrázek s paletou může filtr upravit přímo (např. jen paletu) - uložení pak
+    // nemusí nic kvantizovat. Uvolněné řádky se sestaví znovu z indexů v qImage.
+    const bool rawCurrent = hasCurrentRawData();
+    if (imageBitsPerPixel <= 8 && (rawCurrent || hasIndexedPixels())) {
+        IndexedImage indexed;
+        indexed.palette = colorPalette;
+        indexed.rows = rawData;
+        if (!rawCurrent && !encodePixels(indexed.rows, JobControl::none())) {
+            return false;
+        }
+        indexed.width = imageWidth;
+        indexed.height = imageHeight;
+        indexed.bitsPerPixel = imageBitsPerPixel;
+        indexed.bottomUp = infoHeader.biHeight > 0;
+
+        if (filter.applyToIndexed(indexed)) {
+            if (control.isCanceled()) {
+                return false;
             }
-            else if (imageBitsPerPixel == 1) {
-                // 1 bit = 8 pixelů na bajt
-                int index = byteIndex + x / 8;
-                if (index < rawData.size()) {
-                    int value = static_cast<unsigned char>(rawData[index]);
-                    int shift = 7 - (x % 8);  // 7, 6, 5, 4, 3, 2, 1, 0
-                    int colorIndex = (value >> shift) & 0x01;
-                    pixelColor = colorPalette.value(colorIndex, qRgb(0, 0, 0));
-                } else {
-                    pixelColor = qRgb(0, 0, 0);
-                }
+            // Nová data už neukazují do mapovaného souboru - mapování se uvolní
+            if (indexed.rows.constData() != rawData.constData()) {
+                mappedFile.reset();
             }
-            else {
-                pixelColor = qRgb(0, 0, 0);  // Fallback pro nepodporované formáty
+            colorPalette = indexed.palette;
+            rawData = indexed.rows;
+            rawDataValid = true;
+            dirtyRows = QBitArray();
+            imageWidth = indexed.width;
+            imageHeight = indexed.height;
+            updateDimensionHeaders();
+            if (tileStore) {
+                // Obrázek zůstává po dlaždicích, jen nad novými daty
+                tileStore = createTileStore();
+            } else {
+                renderFromRawData(control);
             }
-
-            qImage.setPixel(x, y, pixelColor);
+            modified = true;
+            if (control.isCanceled()) {
+                return false;
+            }
+            // Pixely jsou teď jen v qImage; pohled do mapování nic nestojí, ten zůstává
+            if (!tileStore && !mappedFile && hasIndexedPixels()) {
+                discardRawData();
+            }
+            if (mipPyramid) {
+                mipPyramid = mipPyramid->derive(filter, qImage);
+            }
+            return true;
         }
     }
 
-}
+    // Filtry pracují s celým obrázkem - obrázek po dlaždicích se teď dekóduje
+    // celý; obrázek větší než QByteArray (jen v mapování) dekódovat nelze
+    if (hasTilesOnly()) {
+        return false;
+    }
+    if (tileStore) {
+        renderFromRawData(control);
+        if (control.isCanceled()) {
+            return false;
+        }
+        tileStore.reset();
+    }
 
-void Image::applyFilter(const Filter &filter) {
-    qImage = filter.apply(qImage);
+    // Filtry dostávají 32bitové pixely - indexy se převedou až teď
+    QImage source = qImage;
+    if (source.format() != QImage::Format_RGB32 && source.format() != QImage::Format_ARGB32) {
+        source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    QImage result = filter.applyCancellable(source, control);
+    if (control.isCanceled()) {
+        return false;
+    }
+    BMP_TRACE_BYTES(qint64(result.bytesPerLine()) * result.height());
+    qImage = result;
     imageWidth = qImage.width();
     imageHeight = qImage.height();
+    updateDimensionHeaders();
     modified = true;
+    // Upravené pixely drží jen qImage, řádky BMP se při uložení zakódují znovu
+    discardRawData();
+    if (mipPyramid) {
+        mipPyramid = mipPyramid->derive(filter, qImage);
+    }
+    return true;
+}
+
+std::shared_ptr<const MipPyramid> Image::pyramid() const {
+    if (!mipPyramid && !qImage.isNull()) {
+        mipPyramid = MipPyramid::create(qImage);
+    }
+    return mipPyramid;
+}
+
+void Image::updateDimensionHeaders() {
+    // Rozměry v hlavičce musí odpovídat obrázku (např. po otočení);
+    // znaménko biHeight určuje pořadí řádků a zůstává zachované
+    infoHeader.biWidth = imageWidth;
+    infoHeader.biHeight = (infoHeader.biHeight < 0) ? -imageHeight : imageHeight;
+}
+
+void Image::headersForSave(qint64 pixelBytes, quint32 compression, BMPFileHeader &saveFileHeader,
+                           BMPInfoHeader &saveInfoHeader) const {
+    // Zapisuje se 40bajtová info header (s alfa kanálem V4), případné masky
+    // a paleta hned za ní, offsety a velikosti se proto přepočítají podle skutečného obsahu
+    qint64 paletteBytes = (imageBitsPerPixel <= 8) ? colorPalette.size() * 4 : 0;
+
+    saveInfoHeader = infoHeader;
+    prepareInfoHeader(saveInfoHeader, compression);
+
+    saveFileHeader = fileHeader;
+    saveFileHeader.bfOffBits = static_cast<quint32>(paletteOffset(saveInfoHeader) + paletteBytes);
+    saveFileHeader.bfSize = static_cast<quint32>(saveFileHeader.bfOffBits + pixelBytes);
+
+    saveInfoHeader.biSizeImage = static_cast<quint32>(pixelBytes);
 }
 
 QImage Image::toQImage() const {
+    // Obrázek po dlaždicích se pro tento účel dekóduje celý (bez uložení)
+    if (tileStore) {
+        return decodeRows(rawData, imageWidth, imageHeight, imageBitsPerPixel, colorPalette, channelMasks(infoHeader),
+                          infoHeader.biHeight > 0, JobControl::none());
+    }
+
     // Kontrola, zda je qImage platný
     if (qImage.isNull() || qImage.width() != imageWidth || qImage.height() != imageHeight) {
         // V případě nekonzistence interních dat, znovu vygenerujeme QImage z raw dat
@@ -383,6 +1192,14 @@ QImage Image::toQImage() const {
     return qImage;
 }
 
+void Image::setSaveCompression(Compression compression) {
+    compressionOnSave = compression;
+}
+
+Image::Compression Image::saveCompression() const {
+    return compressionOnSave;
+}
+
 bool Image::isModified() const {
     return modified;
 }
@@ -390,7 +1207,33 @@ bool Image::isModified() const {
 bool Image::isEmpty() const {
     // Obrázek je prázdný, pokud nemá rozměry (šířka nebo výška je 0)
     // nebo pokud je objekt QImage prázdný
-    return imageWidth <= 0 || imageHeight <= 0 || qImage.isNull();
+    return imageWidth <= 0 || imageHeight <= 0 || (qImage.isNull() && !tileStore);
+}
+
+Image::MemoryUsage Image::memoryUsage() const {
+    MemoryUsage usage = {0, 0, 0, 0, 0, 0};
+    usage.pixels = static_cast<qint64>(qImage.bytesPerLine()) * qImage.height();
+    if (mappedFile) {
+        usage.mapped = mappedFile->size() - mappedRowsOffset;
+    } else {
+        usage.rawData = rawData.size();
+    }
+    if (mipPyramid) {
+        usage.pyramid = mipPyramid->bytesUsed();
+    }
+    if (tileStore) {
+        usage.tiles = tileStore->cachedBytes();
+    }
+    usage.history = history.bytesUsed();
+    return usage;
+}
+
+bool Image::isTiled() const {
+    return tileStore != nullptr;
+}
+
+std::shared_ptr<const TiledImageStore> Image::tiles() const {
+    return tileStore;
 }
 
 int Image::width() const {
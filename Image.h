@@ -1,24 +1,93 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <QBitArray>
 #include <QImage>
 #include <QString>
 #include <QVector>
+#include <memory>
+
+#include "BitFields.h"
+#include "JobControl.h"
+#include "UndoHistory.h"
+
+class MappedFile;
+class MipPyramid;
+class TiledImageStore;
+class QIODevice;
+class RowEncoder;
 
 class Image {
 public:
+    // Způsob načtení souboru: Mapped čte data přímo z paměťově mapovaného
+    // souboru (rawData je jen pohled do mapování), Buffered načte celý soubor do paměti,
+    // Tiled namapuje soubor a pixely dekóduje až po dlaždicích (TiledImageStore) -
+    // celý obrázek se dekóduje teprve při použití filtru
+    enum class LoadMode { Buffered, Mapped, Tiled };
+
     Image();
     ~Image();
 
-    bool loadFromFile(const QString &filePath);
-    bool saveToFile(const QString &filePath) const;
-    void applyFilter(const class Filter &filter);
+    // Operace lze spustit i mimo GUI vlákno nad kopií obrázku; po zrušení
+    // přes 'control' vrací false a s kopií se dál nepracuje
+    bool loadFromFile(const QString &filePath, LoadMode mode = LoadMode::Mapped,
+                      const JobControl &control = JobControl::none());
+    // Zapisuje se do dočasného souboru, který po úspěšném zápisu nahradí cílový
+    bool saveToFile(const QString &filePath, const JobControl &control = JobControl::none()) const;
+    // Varianty bez přístupu k disku: celý obsah BMP souboru v paměti
+    // (např. dávkové zpracování, kde čtení a zápis obstarávají jiná vlákna)
+    bool loadFromData(QByteArray fileData, const JobControl &control = JobControl::none());
+    bool saveToData(QByteArray &fileData, const JobControl &control = JobControl::none()) const;
+    bool applyFilter(const class Filter &filter, const JobControl &control = JobControl::none());
+    // Filtr jen na oblasti obrázku (filtr nesmí měnit rozměry). Řádky mimo
+    // oblast se při uložení zkopírují z původních dat, převádějí se jen změněné.
+    bool applyFilter(const class Filter &filter, const QRect &region,
+                     const JobControl &control = JobControl::none());
+
+    // Zpět/znovu podle historie úprav (viz UndoHistory). Krok s přesnou
+    // inverzí se vrátí inverzním filtrem, jinak se obnoví uložený snímek.
+    bool undo(const JobControl &control = JobControl::none());
+    bool redo(const JobControl &control = JobControl::none());
+    bool canUndo() const;
+    bool canRedo() const;
+    QString undoName() const;
+    QString redoName() const;
+    // Limit paměti snímků historie (0 = historie se nevede, např. při dávkovém zpracování)
+    void setUndoBudget(qint64 bytes);
+
+    // Komprese při ukládání: RleIfSmaller zapíše BI_RLE8/BI_RLE4, pokud je
+    // výsledek menší než nekomprimovaná data (jen 4/8 bitů, řádky odspodu nahoru).
+    // Po načtení odpovídá kompresi zdrojového souboru.
+    enum class Compression { None, RleIfSmaller };
+    void setSaveCompression(Compression compression);
+    Compression saveCompression() const;
 
     QImage toQImage() const;
+    // Pyramida zmenšenin pro zobrazení při oddálení - vytvoří se až při
+    // prvním použití a počítá se na pozadí; filtry ji jen aktualizují
+    std::shared_ptr<const MipPyramid> pyramid() const;
+
+    // Obrázek načtený po dlaždicích ještě nemá dekódované QImage
+    bool isTiled() const;
+    std::shared_ptr<const TiledImageStore> tiles() const;
 
     bool isModified() const;
     bool isEmpty() const;
 
+    // Paměť, kterou obrázek drží, v bajtech. Pohled do namapovaného souboru
+    // se do součtu nepočítá - stránky patří souboru a systém je může kdykoli uvolnit.
+    struct MemoryUsage {
+        qint64 pixels;   // qImage (u obrázku s paletou indexy)
+        qint64 rawData;  // řádky BMP ve vlastní paměti
+        qint64 mapped;   // řádky BMP jako pohled do namapovaného souboru
+        qint64 pyramid;  // spočítané zmenšeniny
+        qint64 tiles;    // dekódované dlaždice v cache
+        qint64 history;  // snímky v historii úprav
+
+        qint64 total() const { return pixels + rawData + pyramid + tiles + history; }
+    };
+    MemoryUsage memoryUsage() const;
+
     // Gettery pro metadata
     int width() const;
     int height() const;
@@ -39,33 +108,132 @@ public:
         int32_t biWidth;          // šířka obrázku v pixelech
         int32_t biHeight;         // výška obrázku v pixelech
         uint16_t biPlanes;         // počet barevných rovin (musí být 1)
-        uint16_t biBitCount;       // počet bitů na pixel (1, 4, 8, 24)
-        uint32_t biCompression;    // typ komprese
+        uint16_t biBitCount;       // počet bitů na pixel (1, 4, 8, 16, 24, 32)
+        uint32_t biCompression;    // typ komprese (0 = BI_RGB, 1 = BI_RLE8, 2 = BI_RLE4, 3 = BI_BITFIELDS)
         uint32_t biSizeImage;      // velikost obrázku v bajtech
         int32_t biXPelsPerMeter;  // horizontální rozlišení
         int32_t biYPelsPerMeter;  // vertikální rozlišení
         uint32_t biClrUsed;        // počet použitých barev
         uint32_t biClrImportant;   // počet důležitých barev
+
+        // Masky kanálů - u BI_BITFIELDS za 40bajtovou hlavičkou, u hlaviček
+        // V4/V5 přímo v ní (pro BI_RGB se nepoužívají, viz channelMasks)
+        uint32_t biRedMask;
+        uint32_t biGreenMask;
+        uint32_t biBlueMask;
+        uint32_t biAlphaMask;
     };
 
     const BMPFileHeader& getFileHeader() const;
     const BMPInfoHeader& getInfoHeader() const;
 
+    // Metadata souboru bez načtení pixelů (viz probe)
+    struct ProbeInfo {
+        bool valid = false;      // Soubor má platné hlavičky BMP
+        bool supported = false;  // a loadFromFile ho umí načíst
+        qint64 fileSize = 0;
+        BMPFileHeader fileHeader = {};
+        BMPInfoHeader infoHeader = {};
+        QVector<QRgb> palette;   // Nanejvýš 2^bitsPerPixel barev
+
+        int width() const { return infoHeader.biWidth; }
+        int height() const { return qAbs(infoHeader.biHeight); }
+        int bitsPerPixel() const { return infoHeader.biBitCount; }
+    };
+    // Přečte jen hlavičky a paletu (obvykle jediným čtením do 1,2 kB) -
+    // pro zjištění rozměrů a formátu bez dekódování pixelů
+    static ProbeInfo probe(const QString &filePath);
+
+    // Pomocné funkce pro práci s BMP formátem (používá je i proudové zpracování)
+    static const int FileHeaderSize = 14;
+    static const int InfoHeaderSize = 40;
+    static const int HeadersSize = 54;
+    static const int V4HeaderSize = 108;
+    static const int V5HeaderSize = 124;
+    // Nejdelší hlavičky včetně masek - stačí přečíst pro parseHeaders
+    static const int MaxHeadersSize = FileHeaderSize + V5HeaderSize;
+
+    static bool parseHeaders(const uchar *data, qint64 size, BMPFileHeader &parsedFileHeader, BMPInfoHeader &parsedInfoHeader);
+    static bool isSupported(const BMPInfoHeader &header);
+    // Masky kanálů 16/32bitového obrázku (u BI_RGB výchozí X1R5G5B5 / X8R8G8B8)
+    static BitFields channelMasks(const BMPInfoHeader &header);
+    // Začátek palety = konec hlavičky a případných masek za ní
+    static qint64 paletteOffset(const BMPInfoHeader &header);
+    // Hlavička pro zápis: 40 bajtů, masky jen pokud se liší od BI_RGB,
+    // s alfa kanálem hlavička V4 (writeHeaders zapíše přesně toto rozložení)
+    static void prepareInfoHeader(BMPInfoHeader &header, quint32 compression);
+    // Hlavičky a paleta se zapíšou jedním voláním write
+    static bool writeHeaders(QIODevice &device, const BMPFileHeader &fileHeaderOut, const BMPInfoHeader &infoHeaderOut,
+                             const QVector<QRgb> &palette);
+    static qint64 calculateRowSize(int width, int bitsPerPixel);
+
 private:
     QImage qImage;
-    QByteArray rawData;
+    // Pixely drží jen jednou: qImage (obrázek s paletou jako indexy) a rawData
+    // jen dokud odpovídají souboru - po úpravě se uvolní a při uložení znovu zakódují.
+    // rawData může být pohledem do namapovaného souboru; obojí se smí uvolnit
+    // i při (const) ukládání, pokud by zápis přepsal namapovaný zdroj
+    mutable QByteArray rawData;
+    mutable std::shared_ptr<MappedFile> mappedFile;
+    mutable std::shared_ptr<MipPyramid> mipPyramid;
+    std::shared_ptr<TiledImageStore> tileStore;
     QVector<QRgb> colorPalette;
     int imageWidth;
     int imageHeight;
     int imageBitsPerPixel;
     bool modified;
+    bool rawDataValid;  // rawData odpovídají aktuálním pixelům (lze je uložit bez kódování)
+    QBitArray dirtyRows;  // Řádky qImage (shora) změněné od rawData; prázdné = žádné
+    Compression compressionOnSave;
     QString sourceFilePath;
+    UndoHistory history;
+    qint64 mappedRowsOffset;  // Začátek pixelových dat v mappedFile
 
     BMPFileHeader fileHeader;
     BMPInfoHeader infoHeader;
 
-    void renderFromRawData();
-    int calculateRowSize() const;
+    bool loadFromSource(const std::shared_ptr<MappedFile> &mapped, QByteArray fileData, LoadMode mode,
+                        const JobControl &control);
+    bool encodePixels(QByteArray &encodedData, const JobControl &control) const;
+    // Pixely pro kodér (indexy, nebo 32bitové řádky) a kódování řádků
+    // [firstRow, endRow) v pořadí souboru do 'output' (vynulovaného)
+    QImage encoderSource() const;
+    void encodeRows(int firstRow, int endRow, const QImage &source, const RowEncoder &encoder, uchar *output,
+                    const JobControl &control) const;
+    bool usesRleOnSave() const;
+    QByteArray compressRows(const QByteArray &rows, quint32 &compression) const;
+    bool writeFile(QIODevice &device, const QByteArray &pixelData, quint32 compression) const;
+    // Kóduje a zapisuje po pásech - bez kopie celého obrázku v paměti
+    bool writeEncodedFile(QIODevice &device, const JobControl &control) const;
+    // Zapíše nezměněné řádky přímo z mapování (obrázek větší než QByteArray)
+    bool writeMappedFile(QIODevice &device, const JobControl &control) const;
+    bool hasCurrentRawData() const;
+    // Obrázek po dlaždicích bez řádků v rawData (větší než 2 GB) - celý ho dekódovat nelze
+    bool hasTilesOnly() const;
+    bool hasCurrentMappedRows() const;
+    // qImage drží přímo indexy palety (Format_Mono / Format_Indexed8)
+    bool hasIndexedPixels() const;
+    // Po úpravě pixelů drží obrázek jen qImage (viz encodePixels)
+    void discardRawData();
+    void updateDimensionHeaders();
+    void headersForSave(qint64 pixelBytes, quint32 compression, BMPFileHeader &saveFileHeader,
+                        BMPInfoHeader &saveInfoHeader) const;
+    void releaseMapping(bool keepData) const;
+    bool applyWithoutHistory(const class Filter &filter, const JobControl &control);
+    bool applyToRegion(const class Filter &filter, const QRect &region, const JobControl &control);
+    QImage regionPixels(const QRect &region) const;
+    void pasteRegion(const QImage &patch, const QPoint &position);
+    void markRowsDirty(int firstRow, int endRow);
+    // Provede krok historie a vrátí krok, který ho vrací zpět
+    bool performStep(const UndoHistory::Step &step, UndoHistory::Step &opposite, const JobControl &control);
+    UndoHistory::Step snapshotStep() const;
+    void restoreSnapshot(const UndoHistory::Step &step);
+    void renderFromRawData(const JobControl &control = JobControl::none(), bool publishPreview = false);
+    std::shared_ptr<TiledImageStore> createTileStore() const;
+    static QImage decodeRows(const QByteArray &rows, int width, int height, int bitsPerPixel,
+                             const QVector<QRgb> &palette, const BitFields &masks, bool bottomUp,
+                             const JobControl &control, bool publishPreview = false);
+    qint64 calculateRowSize() const;
 };
 
 #endif // IMAGE_H
\ No newline at end of file
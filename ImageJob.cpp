@@ -0,0 +1,118 @@
+#include "ImageJob.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+
+namespace {
+
+class RunTask : public QRunnable {
+public:
+    explicit RunTask(std::function<void()> task) : task(std::move(task)) {}
+    void run() override { task(); }
+
+private:
+    std::function<void()> task;
+};
+
+} // namespace
+
+ImageJob::ImageJob(QObject *parent) : QObject(parent) {
+    // Jediné pracovní vlákno - úlohy nad stejným obrázkem nesmí běžet souběžně
+    // (uvnitř úlohy se řádky stejně zpracovávají paralelně)
+    workerPool.setMaxThreadCount(1);
+
+    connect(this, &ImageJob::runProgress, this, &ImageJob::onRunProgress, Qt::QueuedConnection);
+    connect(this, &ImageJob::runFinished, this, &ImageJob::onRunFinished, Qt::QueuedConnection);
+    connect(this, &ImageJob::runPreview, this, &ImageJob::onRunPreview, Qt::QueuedConnection);
+}
+
+ImageJob::~ImageJob() {
+    if (current) {
+        current->control.cancel();
+        current.reset();
+    }
+    workerPool.waitForDone();
+}
+
+void ImageJob::start(const QString &description, const Image &image, Work work, Completion completion) {
+    cancel();
+
+    std::shared_ptr<Run> run = std::make_shared<Run>();
+    run->id = nextRunId++;
+    run->image = image;
+    run->work = std::move(work);
+    run->completion = std::move(completion);
+
+    const quint64 runId = run->id;
+    run->control.setProgressHandler([this, runId](int percent) {
+        emit runProgress(runId, percent);
+    });
+
+    // Handler žije v objektu Run, proto si drží jen ukazatel (ne shared_ptr)
+    Run *runData = run.get();
+    run->control.setPreviewHandler([this, runId, runData](const QImage &preview, int readyRows) {
+        QMutexLocker locker(&runData->previewMutex);
+        runData->previewImage = preview;
+        runData->previewRows = readyRows;
+
+        // Omezení frekvence překreslování; kompletní obrázek se pošle vždy
+        bool complete = readyRows >= preview.height();
+        if (runData->previewPending ||
+            (!complete && runData->previewTimer.isValid() && runData->previewTimer.elapsed() < PreviewIntervalMs)) {
+            return;
+        }
+        runData->previewPending = true;
+        runData->previewTimer.start();
+        emit runPreview(runId);
+    });
+    current = run;
+
+    emit started(description);
+    workerPool.start(new RunTask([this, run]() {
+        if (!run->control.isCanceled()) {
+            run->succeeded = run->work(run->image, run->control);
+        }
+        emit runFinished(run->id);
+    }));
+}
+
+void ImageJob::cancel() {
+    if (!current) return;
+
+    // Pracovní vlákno skončí v nejbližším kontrolním bodě, výsledek se zahodí
+    current->control.cancel();
+    current.reset();
+    emit canceled();
+}
+
+void ImageJob::onRunProgress(quint64 runId, int percent) {
+    if (current && current->id == runId) {
+        emit progressChanged(percent);
+    }
+}
+
+void ImageJob::onRunPreview(quint64 runId) {
+    if (!current || current->id != runId) return;
+
+    QImage preview;
+    int readyRows = 0;
+    {
+        QMutexLocker locker(&current->previewMutex);
+        preview = current->previewImage;
+        readyRows = current->previewRows;
+        current->previewPending = false;
+    }
+    emit previewChanged(preview, readyRows);
+}
+
+void ImageJob::onRunFinished(quint64 runId) {
+    // Zrušené úlohy už nejsou aktuální
+    if (!current || current->id != runId) return;
+
+    std::shared_ptr<Run> run = current;
+    current.reset();
+    if (run->completion) {
+        run->completion(run->succeeded, run->image);
+    }
+    emit finished(run->succeeded);
+}
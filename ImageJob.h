@@ -0,0 +1,80 @@
+#ifndef IMAGEJOB_H
+#define IMAGEJOB_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+
+#include "Image.h"
+#include "JobControl.h"
+
+// Spouští dlouhé operace s obrázkem (načtení, filtr, uložení) v pracovním
+// vlákně. Operace dostane vlastní kopii obrázku (data jsou sdílená, dokud se
+// nezmění), takže GUI mezitím dál zobrazuje poslední hotový stav. Úlohy běží
+// jedna po druhé; spuštění nové úlohy tu předchozí zruší.
+class ImageJob : public QObject {
+    Q_OBJECT
+
+public:
+    // Práce v pracovním vlákně - vrací, zda se operace povedla
+    using Work = std::function<bool(Image &image, const JobControl &control)>;
+    // Dokončení v GUI vlákně (nevolá se po zrušení)
+    using Completion = std::function<void(bool succeeded, Image &image)>;
+
+    explicit ImageJob(QObject *parent = nullptr);
+    ~ImageJob() override;
+
+    bool isRunning() const { return current != nullptr; }
+
+    void start(const QString &description, const Image &image, Work work, Completion completion);
+
+public slots:
+    void cancel();
+
+signals:
+    void started(const QString &description);
+    void progressChanged(int percent);
+    // Částečný výsledek (např. při načítání): horních 'readyRows' řádků je hotových.
+    // Posílá se nejvýš jednou za PreviewIntervalMs.
+    void previewChanged(const QImage &image, int readyRows);
+    void finished(bool succeeded);
+    void canceled();
+
+    // Interní signály z pracovního vlákna (doručí se do GUI vlákna frontou)
+    void runProgress(quint64 runId, int percent);
+    void runFinished(quint64 runId);
+    void runPreview(quint64 runId);
+
+private slots:
+    void onRunProgress(quint64 runId, int percent);
+    void onRunFinished(quint64 runId);
+    void onRunPreview(quint64 runId);
+
+private:
+    static const int PreviewIntervalMs = 50;
+
+    struct Run {
+        quint64 id = 0;
+        JobControl control;
+        Image image;
+        Work work;
+        Completion completion;
+        bool succeeded = false;
+
+        // Poslední částečný výsledek čekající na doručení do GUI vlákna
+        QMutex previewMutex;
+        QImage previewImage;
+        int previewRows = 0;
+        bool previewPending = false;
+        QElapsedTimer previewTimer;
+    };
+
+    QThreadPool workerPool;
+    std::shared_ptr<Run> current;
+    quint64 nextRunId = 1;
+};
+
+#endif // IMAGEJOB_H
@@ -0,0 +1,45 @@
+#include "JobControl.h"
+
+const JobControl &JobControl::none() {
+    static const JobControl control;
+    return control;
+}
+
+void JobControl::setProgressHandler(std::function<void(int)> handler) {
+    progressHandler = std::move(handler);
+}
+
+void JobControl::beginProgress(qint64 total) const {
+    if (!progressHandler) return;
+    totalUnits.store(total);
+    doneUnits.store(0);
+    lastPercent.store(0);
+    progressHandler(0);
+}
+
+void JobControl::addProgress(qint64 units) const {
+    qint64 total = totalUnits.load(std::memory_order_relaxed);
+    if (!progressHandler || total <= 0) return;
+
+    qint64 done = doneUnits.fetch_add(units) + units;
+    int percent = static_cast<int>(qMin<qint64>(100, done * 100 / total));
+
+    // Každou hodnotu ohlásí jen vlákno, kterému se ji podaří zapsat jako první
+    int previous = lastPercent.load();
+    while (percent > previous) {
+        if (lastPercent.compare_exchange_weak(previous, percent)) {
+            progressHandler(percent);
+            break;
+        }
+    }
+}
+
+void JobControl::setPreviewHandler(std::function<void(const QImage &, int)> handler) {
+    previewHandler = std::move(handler);
+}
+
+void JobControl::publishPreview(const QImage &image, int readyRows) const {
+    if (previewHandler) {
+        previewHandler(image, readyRows);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef JOBCONTROL_H
+#define JOBCONTROL_H
+
+#include <QImage>
+#include <QtGlobal>
+#include <atomic>
+#include <functional>
+
+// Řízení dlouhé operace (načtení, filtr, uložení) běžící mimo GUI vlákno.
+// Operace se v kontrolních bodech (typicky na začátku každého pásu řádků)
+// ptají na isCanceled() a hlásí průběh přes addProgress(); obojí lze volat
+// současně z více vláken.
+class JobControl {
+public:
+    JobControl() = default;
+    JobControl(const JobControl &) = delete;
+    JobControl &operator=(const JobControl &) = delete;
+
+    // Řízení, které nikdy není zrušené a průběh nehlásí (synchronní volání)
+    static const JobControl &none();
+
+    void cancel() { canceled.store(true, std::memory_order_relaxed); }
+    bool isCanceled() const { return canceled.load(std::memory_order_relaxed); }
+
+    // Handler dostává průběh v procentech, volá se jen při jeho změně
+    // (z libovolného vlákna); nastavuje se před spuštěním operace
+    void setProgressHandler(std::function<void(int percent)> handler);
+
+    // Začátek fáze o 'total' jednotkách (např. řádcích) a jejich postupné přičítání
+    void beginProgress(qint64 total) const;
+    void addProgress(qint64 units) const;
+
+    // Průběžný výsledek: horních 'readyRows' řádků obrázku je hotových a už
+    // se nezmění (zbytek se právě zapisuje). Handler se nastavuje před
+    // spuštěním operace a volá se z pracovních vláken.
+    void setPreviewHandler(std::function<void(const QImage &image, int readyRows)> handler);
+    bool wantsPreview() const { return static_cast<bool>(previewHandler); }
+    void publishPreview(const QImage &image, int readyRows) const;
+
+private:
+    std::atomic<bool> canceled{false};
+    std::function<void(int)> progressHandler;
+    std::function<void(const QImage &, int)> previewHandler;
+    mutable std::atomic<qint64> totalUnits{0};
+    mutable std::atomic<qint64> doneUnits{0};
+    mutable std::atomic<int> lastPercent{-1};
+};
+
+#endif // JOBCONTROL_H
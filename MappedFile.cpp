@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(const QString &filePath)
+    : file(filePath), mapping(nullptr), mappedSize(0), modifiedNs(0) {}
+
+MappedFile::~MappedFile() {
+    if (mapping != nullptr) {
+        file.unmap(mapping);
+    }
+    file.close();
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const QString &filePath) {
+    std::shared_ptr<MappedFile> mapped(new MappedFile(filePath));
+    if (!mapped->file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    if (!mapped->readStamp(mapped->mappedSize, mapped->modifiedNs) || mapped->mappedSize <= 0) {
+        return nullptr;
+    }
+
+    // MapPrivateOption - případné zápisy do stránek se nikdy nepropíšou do souboru
+    mapped->mapping = mapped->file.map(0, mapped->mappedSize, QFileDevice::MapPrivateOption);
+    if (mapped->mapping == nullptr) {
+        return nullptr;
+    }
+    return mapped;
+}
+
+const uchar *MappedFile::data() const {
+    return mapping;
+}
+
+qint64 MappedFile::size() const {
+    return mappedSize;
+}
+
+QString MappedFile::filePath() const {
+    return file.fileName();
+}
+
+bool MappedFile::isUnchanged() const {
+    qint64 size = 0;
+    qint64 modified = 0;
+    return readStamp(size, modified) && size == mappedSize && modified == modifiedNs;
+}
+
+bool MappedFile::readStamp(qint64 &size, qint64 &modified) const {
+#ifdef Q_OS_UNIX
+    // fstat popisovače - soubor pod stejnou cestou už může být jiný
+    struct stat status;
+    if (fstat(file.handle(), &status) != 0) {
+        return false;
+    }
+#ifdef Q_OS_DARWIN
+    const struct timespec &time = status.st_mtimespec;
+#else
+    const struct timespec &time = status.st_mtim;
+#endif
+    size = status.st_size;
+    modified = static_cast<qint64>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    return true;
+#else
+    // Namapovaný soubor Windows nedovolí zkrátit ani přejmenováním nahradit
+    const QFileInfo info(file.fileName());
+    if (!info.exists()) {
+        return false;
+    }
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch() * 1000000;
+    return true;
+#endif
+}
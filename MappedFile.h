@@ -0,0 +1,47 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+#include <QString>
+#include <memory>
+
+// Soubor namapovaný do paměti pouze pro čtení.
+// Mapování zůstává platné, dokud existuje alespoň jeden shared_ptr na objekt.
+//
+// Bezpečné je jen nahrazení souboru přejmenováním (QSaveFile, většina editorů):
+// mapování dál ukazuje na původní obsah. Zkrácení souboru na místě čtení
+// z mapování neochrání - stránky za novým koncem při čtení vyvolají SIGBUS.
+// isUnchanged() takovou změnu odhalí před dalším čtením, zkrácení souběžné se
+// čtením ale zachytit nelze.
+class MappedFile {
+public:
+    // Vrací nullptr, pokud soubor nelze otevřít nebo namapovat
+    static std::shared_ptr<MappedFile> open(const QString &filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uchar *data() const;
+    qint64 size() const;
+    QString filePath() const;
+
+    // Kontrola, zda otevřený soubor stále odpovídá namapovanému obsahu
+    // (velikost a čas změny). Kontroluje se otevřený soubor, ne cesta -
+    // soubor nahrazený přejmenováním mapování nezneplatní. Volá se před
+    // každým dalším čtením z mapování; false = data dál nečíst.
+    bool isUnchanged() const;
+
+private:
+    explicit MappedFile(const QString &filePath);
+
+    QFile file;
+    uchar *mapping;
+    qint64 mappedSize;
+    qint64 modifiedNs;
+
+    // Velikost a čas změny otevřeného souboru
+    bool readStamp(qint64 &size, qint64 &modified) const;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,204 @@
+#include "MetadataIndex.h"
+#include "Image.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+#include <algorithm>
+
+namespace {
+
+const quint32 IndexMagic = 0x424d5049;  // "BMPI"
+const quint32 IndexVersion = 1;
+
+// Soubory se zadávají poolu po skupinách - úloha na soubor by u stovek
+// tisíc souborů stála víc než samotné zjištění stavu souboru
+const int FilesPerTask = 64;
+
+// Výsledek pro jeden soubor - každé vlákno zapisuje jen do svých položek
+struct Result {
+    MetadataIndex::Entry entry;
+    bool exists = false;
+    bool probed = false;
+};
+
+MetadataIndex::Entry entryFromProbe(const Image::ProbeInfo &info) {
+    MetadataIndex::Entry entry;
+    entry.valid = info.valid;
+    entry.supported = info.supported;
+    if (info.valid) {
+        entry.width = info.width();
+        entry.height = info.height();
+        entry.bitsPerPixel = info.bitsPerPixel();
+        entry.compression = info.infoHeader.biCompression;
+        entry.paletteSize = info.palette.size();
+    }
+    return entry;
+}
+
+QDataStream &operator<<(QDataStream &stream, const MetadataIndex::Entry &entry) {
+    return stream << entry.fileSize << entry.modifiedMs << entry.valid << entry.supported
+                  << qint32(entry.width) << qint32(entry.height) << qint32(entry.bitsPerPixel)
+                  << entry.compression << qint32(entry.paletteSize);
+}
+
+QDataStream &operator>>(QDataStream &stream, MetadataIndex::Entry &entry) {
+    qint32 width, height, bitsPerPixel, paletteSize;
+    stream >> entry.fileSize >> entry.modifiedMs >> entry.valid >> entry.supported
+           >> width >> height >> bitsPerPixel >> entry.compression >> paletteSize;
+    entry.width = width;
+    entry.height = height;
+    entry.bitsPerPixel = bitsPerPixel;
+    entry.paletteSize = paletteSize;
+    return stream;
+}
+
+} // namespace
+
+bool MetadataIndex::load(const QString &indexPath) {
+    entries.clear();
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0, version = 0, count = 0;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion) {
+        return false;
+    }
+
+    entries.reserve(static_cast<int>(qMin<quint32>(count, 1u << 24)));
+    for (quint32 i = 0; i < count; i++) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry;
+        if (stream.status() != QDataStream::Ok) {
+            entries.clear();
+            return false;
+        }
+        entries.insert(path, entry);
+    }
+    return true;
+}
+
+bool MetadataIndex::save(const QString &indexPath) const {
+    // Přerušený zápis nesmí poškodit dosavadní index
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << IndexMagic << IndexVersion << quint32(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        stream << it.key() << it.value();
+    }
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+MetadataIndex::UpdateStats MetadataIndex::update(const QStringList &paths, int threadCount) {
+    BMP_TRACE_SCOPE("index update");
+    UpdateStats stats;
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList keys;
+    keys.reserve(paths.size());
+    for (const QString &path : paths) {
+        keys.append(key(path));
+    }
+
+    // Vlákna index jen čtou, změny se zapíšou až po dokončení všech úloh
+    QVector<Result> results(keys.size());
+    {
+        WorkStealingPool pool(threadCount);
+        for (int first = 0; first < keys.size(); first += FilesPerTask) {
+            const int end = qMin(first + FilesPerTask, keys.size());
+            pool.submit([this, &keys, &results, first, end]() {
+                for (int i = first; i < end; i++) {
+                    const QFileInfo fileInfo(keys[i]);
+                    Result &result = results[i];
+                    result.exists = fileInfo.isFile();
+                    if (!result.exists) {
+                        continue;
+                    }
+                    const qint64 size = fileInfo.size();
+                    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+                    auto cached = entries.constFind(keys[i]);
+                    if (cached != entries.constEnd() && cached->fileSize == size && cached->modifiedMs == modified) {
+                        result.entry = *cached;
+                        continue;
+                    }
+                    result.entry = entryFromProbe(Image::probe(keys[i]));
+                    result.entry.fileSize = size;
+                    result.entry.modifiedMs = modified;
+                    result.probed = true;
+                }
+            });
+        }
+        pool.waitForDone();
+    }
+
+    for (int i = 0; i < keys.size(); i++) {
+        const Result &result = results[i];
+        if (!result.exists) {
+            entries.remove(keys[i]);
+            stats.missing++;
+            continue;
+        }
+        entries.insert(keys[i], result.entry);
+        if (result.probed) {
+            stats.probed++;
+        } else {
+            stats.reused++;
+        }
+    }
+    stats.elapsedNs = timer.nsecsElapsed();
+    return stats;
+}
+
+int MetadataIndex::removeMissing() {
+    int removed = 0;
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        if (QFileInfo(it.key()).isFile()) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool MetadataIndex::contains(const QString &path) const {
+    return entries.contains(key(path));
+}
+
+MetadataIndex::Entry MetadataIndex::entry(const QString &path) const {
+    return entries.value(key(path));
+}
+
+QStringList MetadataIndex::paths() const {
+    QStringList list = entries.keys();
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+int MetadataIndex::size() const {
+    return entries.size();
+}
+
+QString MetadataIndex::key(const QString &path) {
+    return QFileInfo(path).absoluteFilePath();
+}
@@ -0,0 +1,54 @@
+#ifndef METADATAINDEX_H
+#define METADATAINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Index metadat BMP souborů uložený na disku (výsledky Image::probe). Záznam
+// platí, dokud se nezmění velikost a čas změny souboru - opakované procházení
+// velké sbírky proto čte hlavičky jen nových a změněných souborů.
+class MetadataIndex {
+public:
+    struct Entry {
+        qint64 fileSize = 0;
+        qint64 modifiedMs = 0;    // Čas poslední změny (ms od epochy)
+        bool valid = false;       // Platné hlavičky BMP
+        bool supported = false;   // Soubor lze načíst
+        int width = 0;
+        int height = 0;           // Vždy kladná (bez ohledu na pořadí řádků)
+        int bitsPerPixel = 0;
+        quint32 compression = 0;  // biCompression
+        int paletteSize = 0;
+    };
+
+    struct UpdateStats {
+        int probed = 0;    // Nové nebo změněné soubory (přečtené hlavičky)
+        int reused = 0;    // Beze změny - záznam převzatý z indexu
+        int missing = 0;   // Soubory, které nelze otevřít
+        qint64 elapsedNs = 0;
+    };
+
+    // Chybějící, poškozený nebo starší index se načte jako prázdný (false)
+    bool load(const QString &indexPath);
+    bool save(const QString &indexPath) const;
+
+    // Doplní a aktualizuje záznamy daných souborů. Stav souborů se zjišťuje
+    // a hlavičky čtou paralelně (threadCount vláken, 0 = počet jader) -
+    // u sbírky na disku převažuje čekání na I/O.
+    UpdateStats update(const QStringList &paths, int threadCount = 0);
+    // Odstraní záznamy souborů, které už neexistují; vrací jejich počet
+    int removeMissing();
+
+    bool contains(const QString &path) const;
+    Entry entry(const QString &path) const;
+    QStringList paths() const;
+    int size() const;
+
+private:
+    QHash<QString, Entry> entries;  // Klíčem je absolutní cesta
+
+    static QString key(const QString &path);
+};
+
+#endif // METADATAINDEX_H
@@ -0,0 +1,329 @@
+#include "MipPyramid.h"
+#include "ParallelRows.h"
+#include "Filters/Filter.h"
+#include "Filters/Rotation.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIPPYRAMID_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPPYRAMID_SSE2
+#endif
+
+namespace {
+
+class BuildTask : public QRunnable {
+public:
+    explicit BuildTask(std::function<void()> task) : task(std::move(task)) {}
+    void run() override { task(); }
+
+private:
+    std::function<void()> task;
+};
+
+// Průměr bloku 2x2 po kanálech (se zaokrouhlením)
+inline QRgb average(QRgb a, QRgb b, QRgb c, QRgb d) {
+    QRgb result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        quint32 sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) + ((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+        result |= ((sum + 2) >> 2) << shift;
+    }
+    return result;
+}
+
+// Zmenšení řádků 'top' a 'bottom' na výstupní pixely [first, end)
+void downsampleRow(const QRgb *top, const QRgb *bottom, int sourceWidth, QRgb *out, int first, int end) {
+    int x = first;
+    // Poslední výstupní pixel liché šířky má jen jeden zdrojový sloupec
+    const int pairedEnd = qMin(end, sourceWidth / 2);
+#if defined(MIPPYRAMID_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 2 <= pairedEnd; x += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x));
+        // Součet řádků po 16bitových kanálech, potom součet sousedních pixelů
+        __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+        high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+        __m128i sums = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), two), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(sums, zero));
+    }
+#elif defined(MIPPYRAMID_NEON)
+    for (; x + 2 <= pairedEnd; x += 2) {
+        uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(top + 2 * x));
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(bottom + 2 * x));
+        uint16x8_t low = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+        uint16x8_t high = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+        uint16x8_t sums = vcombine_u16(vadd_u16(vget_low_u16(low), vget_high_u16(low)),
+                                       vadd_u16(vget_low_u16(high), vget_high_u16(high)));
+        vst1_u8(reinterpret_cast<uint8_t*>(out + x), vrshrn_n_u16(sums, 2));
+    }
+#endif
+    for (; x < end; x++) {
+        int left = 2 * x;
+        int right = qMin(left + 1, sourceWidth - 1);
+        out[x] = average(top[left], top[right], bottom[left], bottom[right]);
+    }
+}
+
+inline bool isIndexed(const QImage &image) {
+    return image.format() == QImage::Format_Indexed8 || image.format() == QImage::Format_Mono;
+}
+
+// Řádek 'y' jako 32bitové pixely - indexy se přes tabulku barev převedou do 'buffer'
+const QRgb *sourceRow(const QImage &source, const QVector<QRgb> &colors, int y, QVector<QRgb> &buffer) {
+    const uchar *line = source.constScanLine(y);
+    if (source.format() == QImage::Format_Indexed8) {
+        for (int x = 0; x < source.width(); x++) {
+            buffer[x] = colors[line[x]];
+        }
+        return buffer.constData();
+    }
+    if (source.format() == QImage::Format_Mono) {
+        for (int x = 0; x < source.width(); x++) {
+            buffer[x] = colors[(line[x >> 3] >> (7 - (x & 7))) & 1];
+        }
+        return buffer.constData();
+    }
+    return reinterpret_cast<const QRgb*>(line);
+}
+
+// Přepočet oblasti 'dirty' úrovně 'target' z úrovně pod ní
+void downsample(const QImage &image, QImage &target, const QRect &dirty) {
+    // Indexy (obrázek s paletou) se převádějí po řádcích, jiné formáty celé předem
+    const QImage source = (isIndexed(image) || image.format() == QImage::Format_RGB32 ||
+                           image.format() == QImage::Format_ARGB32)
+                          ? image : image.convertToFormat(QImage::Format_ARGB32);
+    // Indexy mimo tabulku barev jsou černé
+    QVector<QRgb> colors(256, qRgb(0, 0, 0));
+    const QVector<QRgb> table = source.colorTable();
+    for (int i = 0; i < table.size() && i < colors.size(); i++) {
+        colors[i] = table[i];
+    }
+
+    const qint64 bytesPerLine = target.bytesPerLine();
+    uchar *bits = target.bits();
+    const int first = dirty.left();
+    const int end = dirty.right() + 1;
+
+    ParallelRows::forEachBand(dirty.height(), bytesPerLine, [&](int firstRow, int endRow) {
+        QVector<QRgb> topBuffer(isIndexed(source) ? source.width() : 0);
+        QVector<QRgb> bottomBuffer(topBuffer.size());
+        for (int row = firstRow; row < endRow; row++) {
+            int y = dirty.top() + row;
+            int top = 2 * y;
+            int bottom = qMin(top + 1, source.height() - 1);
+            downsampleRow(sourceRow(source, colors, top, topBuffer), sourceRow(source, colors, bottom, bottomBuffer),
+                          source.width(), reinterpret_cast<QRgb*>(bits + y * bytesPerLine), first, end);
+        }
+    });
+}
+
+QImage transformed(const QImage &image, const Orientation &orientation, const ChannelLut &lut) {
+    QImage result = orientation.mirrored ? image.mirrored(true, false) : image;
+    result = Rotation::rotate(result, orientation.quarterTurns);
+    if (lut.isIdentity()) {
+        return result;
+    }
+
+    // Zmenšeniny jsou vždy 32bitové - tabulka se použije po řádcích
+    const int width = result.width();
+    const qint64 bytesPerLine = result.bytesPerLine();
+    uchar *bits = result.bits();
+    ParallelRows::forEachBand(result.height(), bytesPerLine, [&](int firstRow, int endRow) {
+        for (int y = firstRow; y < endRow; y++) {
+            lut.applyToRow(reinterpret_cast<QRgb*>(bits + y * bytesPerLine), width);
+        }
+    });
+    return result;
+}
+
+// Oblast úrovně, kterou ovlivní změna oblasti 'rect' úrovně pod ní
+QRect parentRect(const QRect &rect) {
+    if (rect.isEmpty()) return QRect();
+    return QRect(QPoint(rect.left() / 2, rect.top() / 2), QPoint(rect.right() / 2, rect.bottom() / 2));
+}
+
+} // namespace
+
+std::shared_ptr<MipPyramid> MipPyramid::withBase(const QImage &base) {
+    std::shared_ptr<MipPyramid> pyramid(new MipPyramid());
+
+    // Základ sdílí pixely s obrázkem i u indexů (obrázek s paletou) - na 32 bitů
+    // se převádějí až řádky při výpočtu první zmenšeniny
+    Level baseLevel;
+    baseLevel.image = base;
+    pyramid->levels.append(baseLevel);
+
+    int width = base.width();
+    int height = base.height();
+    while (qMax(width, height) > MinLevelSize) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        Level level;
+        level.dirty = QRect(0, 0, width, height);
+        pyramid->levels.append(level);
+    }
+    return pyramid;
+}
+
+std::shared_ptr<MipPyramid> MipPyramid::create(const QImage &base) {
+    std::shared_ptr<MipPyramid> pyramid = withBase(base);
+    pyramid->startBuilding(pyramid);
+    return pyramid;
+}
+
+std::shared_ptr<MipPyramid> MipPyramid::derive(const Filter &filter, const QImage &newBase) const {
+    std::shared_ptr<MipPyramid> pyramid = withBase(newBase);
+
+    // Otočení a převrácení jen přeskládají pixely; úroveň k lze přeskládat
+    // přesně, pokud rozměry základu jsou dělitelné 2^k (bloky se nezmění)
+    Orientation orientation;
+    ChannelLut lut;
+    if (filter.describeGeometry(orientation)) {
+        QMutexLocker locker(&mutex);
+        const QImage &oldBase = levels[0].image;
+        for (int i = 1; i < levels.size() && i < pyramid->levels.size(); i++) {
+            const int blockSize = 1 << i;
+            if (oldBase.width() % blockSize != 0 || oldBase.height() % blockSize != 0 || !levels[i].isReady()) {
+                break;
+            }
+            Level &level = pyramid->levels[i];
+            level.dirty = QRect();
+            level.transformPending = true;
+            level.previous = levels[i].image;
+            level.orientation = orientation;
+        }
+    } else if (filter.describeLut(lut)) {
+        // Tabulka mapuje každý pixel zvlášť, hotové úrovně se tedy jen přemapují.
+        // U lineárních tabulek (inverze) se průměr přemapovaných pixelů liší od
+        // přemapovaného průměru jen zaokrouhlením, tedy o pár úrovní jasu, což
+        // pro náhled při oddálení stačí.
+        QMutexLocker locker(&mutex);
+        for (int i = 1; i < levels.size() && i < pyramid->levels.size(); i++) {
+            if (!levels[i].isReady()) {
+                continue;  // Úroveň se spočítá z přemapované úrovně pod ní
+            }
+            Level &level = pyramid->levels[i];
+            level.dirty = QRect();
+            level.transformPending = true;
+            level.previous = levels[i].image;
+            level.lut = lut;
+        }
+    }
+
+    pyramid->startBuilding(pyramid);
+    return pyramid;
+}
+
+std::shared_ptr<MipPyramid> MipPyramid::derive(const QRect &changedRect, const QImage &newBase) const {
+    std::shared_ptr<MipPyramid> pyramid = withBase(newBase);
+
+    {
+        QMutexLocker locker(&mutex);
+        if (levels[0].image.size() == newBase.size() && levels.size() == pyramid->levels.size()) {
+            // Ve zbytku úrovní zůstanou původní pixely, přepočítá se jen dotčená oblast
+            QRect changed = changedRect.intersected(newBase.rect());
+            for (int i = 1; i < levels.size(); i++) {
+                changed = parentRect(changed);
+                Level &level = pyramid->levels[i];
+                if (levels[i].image.isNull() || levels[i].transformPending) {
+                    continue;  // Celá úroveň se spočítá znovu
+                }
+                level.image = levels[i].image;
+                level.dirty = changed.united(levels[i].dirty);
+            }
+        }
+    }
+
+    pyramid->startBuilding(pyramid);
+    return pyramid;
+}
+
+void MipPyramid::startBuilding(const std::shared_ptr<MipPyramid> &self) const {
+    if (isComplete()) return;
+    std::weak_ptr<MipPyramid> weak = self;
+    QThreadPool::globalInstance()->start(new BuildTask([weak]() { build(weak); }));
+}
+
+void MipPyramid::build(const std::weak_ptr<MipPyramid> &pyramid) {
+    // Úrovně se počítají postupně zdola; nepotřebná pyramida se přestane počítat
+    for (int i = 1; ; i++) {
+        std::shared_ptr<MipPyramid> self = pyramid.lock();
+        if (!self) return;
+
+        QImage source;
+        Level level;
+        {
+            QMutexLocker locker(&self->mutex);
+            if (i >= self->levels.size()) return;
+            source = self->levels[i - 1].image;
+            level = self->levels[i];
+        }
+
+        if (level.transformPending) {
+            level.image = transformed(level.previous, level.orientation, level.lut);
+        } else if (!level.dirty.isEmpty()) {
+            if (level.image.isNull()) {
+                const bool argb = source.format() == QImage::Format_ARGB32 ||
+                                  (source.format() != QImage::Format_RGB32 && source.hasAlphaChannel());
+                level.image = QImage((source.width() + 1) / 2, (source.height() + 1) / 2,
+                                     argb ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+            }
+            // Zápis do sdíleného obrázku ho zkopíruje - zobrazená verze zůstává platná
+            downsample(source, level.image, level.dirty);
+        } else {
+            continue;
+        }
+
+        QMutexLocker locker(&self->mutex);
+        Level &stored = self->levels[i];
+        stored.image = level.image;
+        stored.dirty = QRect();
+        stored.transformPending = false;
+        stored.previous = QImage();
+    }
+}
+
+QImage MipPyramid::levelForZoom(double zoom, int *level) const {
+    QMutexLocker locker(&mutex);
+    int wanted = (zoom > 0.0 && zoom < 1.0) ? static_cast<int>(std::floor(std::log2(1.0 / zoom))) : 0;
+    wanted = qMin(wanted, levels.size() - 1);
+    while (wanted > 0 && !levels[wanted].isReady()) {
+        wanted--;
+    }
+    if (level) {
+        *level = wanted;
+    }
+    return levels[wanted].image;
+}
+
+qint64 MipPyramid::bytesUsed() const {
+    QMutexLocker locker(&mutex);
+    qint64 bytes = 0;
+    for (int i = 1; i < levels.size(); i++) {
+        bytes += static_cast<qint64>(levels[i].image.bytesPerLine()) * levels[i].image.height();
+    }
+    return bytes;
+}
+
+int MipPyramid::levelCount() const {
+    QMutexLocker locker(&mutex);
+    return levels.size();
+}
+
+bool MipPyramid::isComplete() const {
+    QMutexLocker locker(&mutex);
+    for (int i = 1; i < levels.size(); i++) {
+        if (!levels[i].isReady()) return false;
+    }
+    return true;
+}
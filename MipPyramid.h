@@ -0,0 +1,64 @@
+#ifndef MIPPYRAMID_H
+#define MIPPYRAMID_H
+
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QVector>
+#include <memory>
+
+#include "Filters/PixelOps.h"
+
+class Filter;
+
+// Pyramida zmenšenin obrázku pro zobrazení při oddálení. Úroveň k má
+// rozměry základu dělené 2^k (zaokrouhleno nahoru), každý její pixel je
+// průměrem bloku 2x2 pixelů úrovně pod ní. Úrovně se počítají na pozadí;
+// dokud úroveň není hotová, zobrazuje se jemnější úroveň.
+//
+// Pyramida se po vytvoření navenek nemění - změněný obrázek dostane novou
+// pyramidu odvozenou z původní, ve které se přepočítají jen dotčené oblasti
+// (nebo se úrovně jen přeskládají či přemapují tabulkou barev).
+class MipPyramid {
+public:
+    static std::shared_ptr<MipPyramid> create(const QImage &base);
+
+    // Pyramida pro obrázek, který vznikl použitím filtru na tento základ
+    std::shared_ptr<MipPyramid> derive(const Filter &filter, const QImage &newBase) const;
+    // Pyramida pro obrázek, ve kterém se změnila jen oblast 'changedRect' základu
+    std::shared_ptr<MipPyramid> derive(const QRect &changedRect, const QImage &newBase) const;
+
+    // Nejhrubší hotová úroveň, jejíž pixely na obrazovce nejsou menší než
+    // jeden bod (úroveň 0 je samotný základ)
+    QImage levelForZoom(double zoom, int *level) const;
+
+    int levelCount() const;
+    bool isComplete() const;
+    // Paměť spočítaných zmenšenin (základ sdílí pixely s obrázkem, nepočítá se)
+    qint64 bytesUsed() const;
+
+private:
+    // Pod touto velikostí delší strany se další úrovně už nevytvářejí
+    static const int MinLevelSize = 64;
+
+    struct Level {
+        QImage image;            // Prázdný, dokud úroveň nebyla spočítána
+        QRect dirty;             // Oblast, kterou je třeba přepočítat z nižší úrovně
+        bool transformPending = false;
+        QImage previous;         // Úroveň původní pyramidy, která se jen přeskládá a přemapuje
+        Orientation orientation;
+        ChannelLut lut = ChannelLut::identity();
+
+        bool isReady() const { return !image.isNull() && dirty.isEmpty() && !transformPending; }
+    };
+
+    mutable QMutex mutex;
+    QVector<Level> levels;  // levels[0] = základ
+
+    MipPyramid() = default;
+    static std::shared_ptr<MipPyramid> withBase(const QImage &base);
+    void startBuilding(const std::shared_ptr<MipPyramid> &self) const;
+    static void build(const std::weak_ptr<MipPyramid> &pyramid);
+};
+
+#endif // MIPPYRAMID_H
@@ -0,0 +1,114 @@
+#include "PaletteMapper.h"
+
+#include <climits>
+
+namespace {
+
+inline int squaredDistance(QRgb a, QRgb b) {
+    int rDiff = qRed(a) - qRed(b);
+    int gDiff = qGreen(a) - qGreen(b);
+    int bDiff = qBlue(a) - qBlue(b);
+    return rDiff * rDiff + gDiff * gDiff + bDiff * bDiff;
+}
+
+// Nejmenší a největší vzdálenost hodnoty kanálu od intervalu [low, high]
+inline int minChannelDistance(int value, int low, int high) {
+    if (value < low) return low - value;
+    if (value > high) return value - high;
+    return 0;
+}
+
+inline int maxChannelDistance(int value, int low, int high) {
+    return qMax(qAbs(value - low), qAbs(value - high));
+}
+
+} // namespace
+
+PaletteMapper::PaletteMapper(const QVector<QRgb> &palette, int limit) {
+    int count = qBound(0, limit, palette.size());
+    colors.reserve(count);
+    for (int i = 0; i < count; i++) {
+        colors.append(palette[i]);
+    }
+
+    if (colors.size() > LinearSearchLimit) {
+        buildCells();
+    }
+}
+
+int PaletteMapper::nearest(QRgb color) const {
+    if (cellStart.isEmpty()) {
+        return nearestLinear(color);
+    }
+
+    int cell = ((qRed(color) >> CellShift) * CellsPerAxis + (qGreen(color) >> CellShift)) * CellsPerAxis
+               + (qBlue(color) >> CellShift);
+
+    int bestMatch = 0;
+    int bestDiff = INT_MAX;
+    const int *candidate = candidates.constData();
+    for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+        int diff = squaredDistance(color, colors[candidate[i]]);
+        if (diff < bestDiff) {
+            bestDiff = diff;
+            bestMatch = candidate[i];
+        }
+    }
+    return bestMatch;
+}
+
+int PaletteMapper::nearestLinear(QRgb color) const {
+    int bestMatch = 0;
+    int bestDiff = INT_MAX;
+    for (int i = 0; i < colors.size(); i++) {
+        int diff = squaredDistance(color, colors[i]);
+        if (diff < bestDiff) {
+            bestDiff = diff;
+            bestMatch = i;
+        }
+    }
+    return bestMatch;
+}
+
+void PaletteMapper::buildCells() {
+    const int cellCount = CellsPerAxis * CellsPerAxis * CellsPerAxis;
+    const int cellSize = 1 << CellShift;
+    cellStart.resize(cellCount + 1);
+
+    QVector<int> minDistance(colors.size());
+    int cell = 0;
+    for (int r = 0; r < CellsPerAxis; r++) {
+        for (int g = 0; g < CellsPerAxis; g++) {
+            for (int b = 0; b < CellsPerAxis; b++, cell++) {
+                int rLow = r * cellSize, gLow = g * cellSize, bLow = b * cellSize;
+                int rHigh = rLow + cellSize - 1, gHigh = gLow + cellSize - 1, bHigh = bLow + cellSize - 1;
+
+                // Nejbližší barva libovolného bodu buňky je nejvýš tak daleko,
+                // jako nejmenší "nejhorší" vzdálenost některé barvy palety
+                int bound = INT_MAX;
+                for (int i = 0; i < colors.size(); i++) {
+                    QRgb c = colors[i];
+                    int rMin = minChannelDistance(qRed(c), rLow, rHigh);
+                    int gMin = minChannelDistance(qGreen(c), gLow, gHigh);
+                    int bMin = minChannelDistance(qBlue(c), bLow, bHigh);
+                    minDistance[i] = rMin * rMin + gMin * gMin + bMin * bMin;
+
+                    int rMax = maxChannelDistance(qRed(c), rLow, rHigh);
+                    int gMax = maxChannelDistance(qGreen(c), gLow, gHigh);
+                    int bMax = maxChannelDistance(qBlue(c), bLow, bHigh);
+                    bound = qMin(bound, rMax * rMax + gMax * gMax + bMax * bMax);
+                }
+
+                // Kandidáti včetně barev se shodnou vzdáleností, aby se zachovalo
+                // pravidlo "nižší index vyhrává"
+                cellStart[cell] = candidates.size();
+                for (int i = 0; i < colors.size(); i++) {
+                    if (minDistance[i] <= bound) {
+                        candidates.append(i);
+                    }
+                }
+            }
+        }
+    }
+    cellStart[cellCount] = candidates.size();
+}
@@ -0,0 +1,31 @@
+#ifndef PALETTEMAPPER_H
+#define PALETTEMAPPER_H
+
+#include <QRgb>
+#include <QVector>
+
+// Hledání nejbližší barvy v paletě (čtverec vzdálenosti v RGB prostoru,
+// při shodě vyhrává nižší index). Paleta se jednou předzpracuje do mřížky
+// 16x16x16 buněk; každá buňka si pamatuje jen ty barvy, které mohou být
+// nejbližší pro některý bod buňky, takže se neprochází celá paleta.
+class PaletteMapper {
+public:
+    // Použije se prvních 'limit' barev palety
+    PaletteMapper(const QVector<QRgb> &palette, int limit);
+
+    int nearest(QRgb color) const;
+
+private:
+    static const int CellShift = 4;                  // 16 hodnot kanálu na buňku
+    static const int CellsPerAxis = 256 >> CellShift;
+    static const int LinearSearchLimit = 8;          // Malé palety se prohledávají přímo
+
+    QVector<QRgb> colors;
+    QVector<int> cellStart;   // Začátek seznamu kandidátů buňky (CellsPerAxis^3 + 1 položek)
+    QVector<int> candidates;  // Indexy kandidátů, v každé buňce vzestupně
+
+    int nearestLinear(QRgb color) const;
+    void buildCells();
+};
+
+#endif // PALETTEMAPPER_H
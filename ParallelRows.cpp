@@ -0,0 +1,119 @@
+#include "ParallelRows.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+
+namespace {
+
+// Cílová velikost jednoho pásu a minimální velikost obrázku pro paralelizaci
+const qint64 TargetBandBytes = 256 * 1024;
+const qint64 MinParallelBytes = 1024 * 1024;
+// Počet pásů na vlákno - rezerva pro vyrovnání nerovnoměrné zátěže
+const int BandsPerThread = 4;
+
+std::atomic<int> configuredThreads(0);
+thread_local bool insideBand = false;
+
+QThreadPool *bandPool() {
+    static QThreadPool pool;
+    return &pool;
+}
+
+struct BandJob {
+    int rows;
+    int bandRows;
+    int bandCount;
+    std::atomic<int> nextBand;
+    const std::function<void(int, int)> *function;
+    QSemaphore helpersDone;
+
+    // Vlákna si berou pásy postupně, dokud nějaké zbývají
+    void processBands() {
+        insideBand = true;
+        for (int band = nextBand++; band < bandCount; band = nextBand++) {
+            int first = band * bandRows;
+            (*function)(first, qMin(first + bandRows, rows));
+        }
+        insideBand = false;
+    }
+};
+
+class BandWorker : public QRunnable {
+public:
+    explicit BandWorker(BandJob *job) : job(job) {}
+
+    void run() override {
+        job->processBands();
+        job->helpersDone.release();  // Po uvolnění už se na job nesmí sahat
+    }
+
+private:
+    BandJob *job;
+};
+
+} // namespace
+
+ParallelRows::SerialScope::SerialScope() : previous(insideBand) {
+    insideBand = true;
+}
+
+ParallelRows::SerialScope::~SerialScope() {
+    insideBand = previous;
+}
+
+void ParallelRows::setThreadCount(int count) {
+    configuredThreads = qMax(0, count);
+}
+
+int ParallelRows::threadCount() {
+    int count = configuredThreads;
+    if (count <= 0) {
+        count = qEnvironmentVariableIntValue("BMPEDITOR_THREADS");
+    }
+    if (count <= 0) {
+        count = QThread::idealThreadCount();
+    }
+    return qMax(1, count);
+}
+
+void ParallelRows::forEachBand(int rows, qint64 bytesPerRow, const std::function<void(int, int)> &function) {
+    if (rows <= 0) {
+        return;
+    }
+
+    int threads = threadCount();
+    bytesPerRow = qMax<qint64>(1, bytesPerRow);
+
+    // Malé obrázky, jedno vlákno nebo volání zevnitř jiného pásu - bez paralelizace
+    if (threads == 1 || insideBand || rows * bytesPerRow < MinParallelBytes) {
+        function(0, rows);
+        return;
+    }
+
+    // Pás by měl mít zhruba TargetBandBytes, ale pásů musí být dost pro všechna vlákna
+    qint64 bandRows = qMax<qint64>(1, TargetBandBytes / bytesPerRow);
+    bandRows = qMin<qint64>(bandRows, qMax(1, rows / (threads * BandsPerThread)));
+
+    BandJob job;
+    job.rows = rows;
+    job.bandRows = static_cast<int>(bandRows);
+    job.bandCount = static_cast<int>((rows + bandRows - 1) / bandRows);
+    job.nextBand = 0;
+    job.function = &function;
+
+    int helpers = qMin(threads - 1, job.bandCount - 1);
+    QThreadPool *pool = bandPool();
+    if (pool->maxThreadCount() < helpers) {
+        pool->setMaxThreadCount(helpers);
+    }
+    for (int i = 0; i < helpers; i++) {
+        pool->start(new BandWorker(&job));
+    }
+
+    // Volající vlákno se zapojí také, takže zpracování nikdy nečeká jen na pool
+    job.processBands();
+    job.helpersDone.acquire(helpers);
+}
@@ -0,0 +1,35 @@
+#ifndef PARALLELROWS_H
+#define PARALLELROWS_H
+
+#include <QtGlobal>
+#include <functional>
+
+// Paralelní zpracování řádků obrázku po pásech (řádky jsou na sobě nezávislé).
+// Každý pás zpracuje právě jedno vlákno, výsledek je proto stejný jako při
+// jednovláknovém zpracování.
+namespace ParallelRows {
+    // Počet vláken včetně volajícího (0 = proměnná prostředí BMPEDITOR_THREADS,
+    // jinak počet jader procesoru)
+    void setThreadCount(int count);
+    int threadCount();
+
+    // Zavolá function(firstRow, endRow) pro disjunktní pásy pokrývající [0, rows).
+    // Velikost pásu se odvozuje od počtu bajtů na řádek, malé obrázky
+    // a vnořená volání se zpracují přímo ve volajícím vlákně.
+    void forEachBand(int rows, qint64 bytesPerRow, const std::function<void(int, int)> &function);
+
+    // Po dobu existence zpracuje forEachBand v tomto vlákně vše přímo - pro
+    // vlákna, která už běží paralelně na vyšší úrovni (např. po souborech)
+    class SerialScope {
+    public:
+        SerialScope();
+        ~SerialScope();
+        SerialScope(const SerialScope&) = delete;
+        SerialScope& operator=(const SerialScope&) = delete;
+
+    private:
+        bool previous;
+    };
+}
+
+#endif // PARALLELROWS_H
@@ -0,0 +1,268 @@
+#include "RleCodec.h"
+#include "ParallelRows.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+// Escape sekvence (první bajt dvojice je 0)
+const uchar EndOfLine = 0;
+const uchar EndOfBitmap = 1;
+const uchar Delta = 2;
+
+const int MaxRun = 255;
+
+qint64 rowSize(int width, int bitsPerPixel) {
+    return ((static_cast<qint64>(width) * bitsPerPixel + 31) / 32) * 4;
+}
+
+inline void setNibble(uchar *row, int x, int value) {
+    uchar &byte = row[x / 2];
+    byte = (x % 2 == 0) ? static_cast<uchar>((byte & 0x0f) | (value << 4))
+                        : static_cast<uchar>((byte & 0xf0) | value);
+}
+
+// Běh RLE4 střídá horní a dolní půlbajt 'value'; od sudé pozice jde o celé bajty
+void fillNibbles(uchar *row, int x, int count, uchar value) {
+    int i = 0;
+    uchar pattern = value;
+    if (x % 2 != 0) {
+        setNibble(row, x, value >> 4);
+        pattern = static_cast<uchar>((value << 4) | (value >> 4));
+        i = 1;
+    }
+    int pairs = (count - i) / 2;
+    memset(row + (x + i) / 2, pattern, static_cast<size_t>(pairs));
+    i += 2 * pairs;
+    if (i < count) {
+        setNibble(row, x + i, (i % 2 == 0) ? value >> 4 : value & 0x0f);
+    }
+}
+
+void copyNibbles(uchar *row, int x, const uchar *source, int count) {
+    if (x % 2 == 0) {
+        memcpy(row + x / 2, source, static_cast<size_t>(count / 2));
+        if (count % 2 != 0) {
+            setNibble(row, x + count - 1, source[count / 2] >> 4);
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        setNibble(row, x + i, (i % 2 == 0) ? source[i / 2] >> 4 : source[i / 2] & 0x0f);
+    }
+}
+
+// Délka běhu od 'x' (nejvýš 'limit'): stejné pixely, u RLE4 dvojice střídajících se pixelů
+int runLength(const uchar *pixels, int x, int width, bool rle4, int limit) {
+    int end = qMin(width, x + limit);
+    int length = 1;
+    if (rle4) {
+        if (x + 1 >= end) {
+            return length;
+        }
+        length = 2;
+        while (x + length < end && pixels[x + length] == pixels[x + (length % 2)]) {
+            length++;
+        }
+        return length;
+    }
+    while (x + length < end && pixels[x + length] == pixels[x]) {
+        length++;
+    }
+    return length;
+}
+
+void appendPair(QByteArray &out, int first, int second) {
+    out.append(static_cast<char>(first));
+    out.append(static_cast<char>(second));
+}
+
+void appendRun(QByteArray &out, const uchar *pixels, int x, int length, bool rle4) {
+    if (!rle4) {
+        appendPair(out, length, pixels[x]);
+        return;
+    }
+    int second = (length > 1) ? pixels[x + 1] : 0;
+    appendPair(out, length, (pixels[x] << 4) | second);
+}
+
+// Pixely bez dlouhých běhů; absolutní režim je možný až od 3 pixelů
+void appendLiteral(QByteArray &out, const uchar *pixels, int x, int length, bool rle4) {
+    if (length < 3) {
+        if (rle4) {
+            appendRun(out, pixels, x, length, true);
+        } else {
+            for (int i = 0; i < length; i++) {
+                appendPair(out, 1, pixels[x + i]);
+            }
+        }
+        return;
+    }
+
+    appendPair(out, 0, length);
+    int bytes = 0;
+    if (rle4) {
+        for (int i = 0; i < length; i += 2) {
+            int low = (i + 1 < length) ? pixels[x + i + 1] : 0;
+            out.append(static_cast<char>((pixels[x + i] << 4) | low));
+            bytes++;
+        }
+    } else {
+        out.append(reinterpret_cast<const char*>(pixels + x), length);
+        bytes = length;
+    }
+    // Absolutní úsek je zarovnaný na 16 bitů
+    if (bytes % 2 != 0) {
+        out.append('\0');
+    }
+}
+
+void encodeLine(const uchar *pixels, int width, bool rle4, QByteArray &out) {
+    // Kratší běh se nevyplatí - přerušení absolutního úseku stojí víc
+    const int minRun = rle4 ? 4 : 3;
+    int x = 0;
+    while (x < width) {
+        int run = runLength(pixels, x, width, rle4, MaxRun);
+        if (run >= minRun) {
+            appendRun(out, pixels, x, run, rle4);
+            x += run;
+            continue;
+        }
+
+        int start = x;
+        x++;
+        while (x < width && x - start < MaxRun && runLength(pixels, x, width, rle4, minRun) < minRun) {
+            x++;
+        }
+        appendLiteral(out, pixels, start, x - start, rle4);
+    }
+    appendPair(out, 0, EndOfLine);
+}
+
+} // namespace
+
+quint32 RleCodec::compressionFor(int bitsPerPixel) {
+    switch (bitsPerPixel) {
+        case 8: return Rle8;
+        case 4: return Rle4;
+        default: return 0;
+    }
+}
+
+bool RleCodec::decode(const uchar *data, qint64 size, int bitsPerPixel, int width, int height, QByteArray &rows) {
+    const qint64 bytesPerRow = rowSize(width, bitsPerPixel);
+    rows = QByteArray(static_cast<int>(bytesPerRow * height), 0);
+    uchar *output = reinterpret_cast<uchar*>(rows.data());
+    const bool rle4 = bitsPerPixel == 4;
+
+    qint64 position = 0;
+    int x = 0;
+    int y = 0;
+    while (y < height) {
+        if (position + 2 > size) {
+            return false;
+        }
+        const int count = data[position];
+        const uchar value = data[position + 1];
+        position += 2;
+        uchar *row = output + y * bytesPerRow;
+
+        // Zakódovaný běh: 'count' pixelů hodnoty 'value'; pixely za šířkou se zahodí
+        if (count > 0) {
+            int visible = qMin(count, width - x);
+            if (visible > 0) {
+                if (rle4) {
+                    fillNibbles(row, x, visible, value);
+                } else {
+                    memset(row + x, value, static_cast<size_t>(visible));
+                }
+            }
+            x = qMin(width, x + count);
+            continue;
+        }
+
+        switch (value) {
+            case EndOfLine:
+                x = 0;
+                y++;
+                break;
+            case EndOfBitmap:
+                return true;
+            case Delta:
+                if (position + 2 > size) {
+                    return false;
+                }
+                x = qMin(width, x + data[position]);
+                y += data[position + 1];
+                position += 2;
+                break;
+            default: {
+                // Absolutní režim: 'value' pixelů uložených za sebou, zarovnáno na 16 bitů
+                const int pixels = value;
+                const qint64 bytes = rle4 ? (pixels + 1) / 2 : pixels;
+                if (position + bytes > size) {
+                    return false;
+                }
+                int visible = qMin(pixels, width - x);
+                if (visible > 0) {
+                    if (rle4) {
+                        copyNibbles(row, x, data + position, visible);
+                    } else {
+                        memcpy(row + x, data + position, static_cast<size_t>(visible));
+                    }
+                }
+                x = qMin(width, x + pixels);
+                position += (bytes + 1) & ~qint64(1);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+QByteArray RleCodec::encode(const QByteArray &rows, int bitsPerPixel, int width, int height) {
+    const qint64 bytesPerRow = rowSize(width, bitsPerPixel);
+    const uchar *input = reinterpret_cast<const uchar*>(rows.constData());
+    const bool rle4 = bitsPerPixel == 4;
+
+    // Řádky se kódují nezávisle, pásy se pak spojí v původním pořadí
+    QMutex bandsMutex;
+    QMap<int, QByteArray> bands;
+    ParallelRows::forEachBand(height, bytesPerRow, [&](int firstRow, int endRow) {
+        QByteArray encoded;
+        encoded.reserve(static_cast<int>((endRow - firstRow) * (bytesPerRow + 2)));
+        QVector<uchar> unpacked(rle4 ? width : 0);
+        for (int y = firstRow; y < endRow; y++) {
+            const uchar *row = input + y * bytesPerRow;
+            if (rle4) {
+                for (int x = 0; x < width; x++) {
+                    unpacked[x] = (x % 2 == 0) ? row[x / 2] >> 4 : row[x / 2] & 0x0f;
+                }
+                row = unpacked.constData();
+            }
+            encodeLine(row, width, rle4, encoded);
+        }
+        QMutexLocker locker(&bandsMutex);
+        bands.insert(firstRow, encoded);
+    });
+
+    QByteArray result;
+    qint64 total = 0;
+    for (const QByteArray &band : bands) {
+        total += band.size();
+    }
+    result.reserve(static_cast<int>(total));
+    for (const QByteArray &band : bands) {
+        result.append(band);
+    }
+
+    // Poslední konec řádku nahradí konec obrázku
+    if (result.size() >= 2) {
+        result[result.size() - 1] = static_cast<char>(EndOfBitmap);
+    }
+    return result;
+}
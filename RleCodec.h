@@ -0,0 +1,28 @@
+#ifndef RLECODEC_H
+#define RLECODEC_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// Komprese BI_RLE8 (8 bitů na pixel) a BI_RLE4 (4 bity na pixel).
+// Řádky se rozbalují rovnou do stejného rozložení jako nekomprimovaná data
+// (řádky zarovnané na 4 bajty, první řádek souboru je spodní řádek obrázku),
+// takže se dál dekódují stejnou cestou jako BI_RGB.
+namespace RleCodec {
+    const quint32 Rle8 = 1;  // Hodnoty biCompression
+    const quint32 Rle4 = 2;
+
+    // Komprese odpovídající bitové hloubce (0 = pro tuto hloubku neexistuje)
+    quint32 compressionFor(int bitsPerPixel);
+    inline bool isRle(quint32 compression) { return compression == Rle8 || compression == Rle4; }
+
+    // Rozbalí RLE data do 'rows'. Pixely přeskočené posunem (delta) nebo
+    // koncem řádku zůstanou s indexem 0. Vrací false, pokud data skončí
+    // dřív, než je obrázek celý (dosud rozbalené řádky v 'rows' zůstanou).
+    bool decode(const uchar *data, qint64 size, int bitsPerPixel, int width, int height, QByteArray &rows);
+
+    // Zakóduje nekomprimované řádky (rozložení jako u BI_RGB)
+    QByteArray encode(const QByteArray &rows, int bitsPerPixel, int width, int height);
+}
+
+#endif // RLECODEC_H
@@ -0,0 +1,280 @@
+#include "RowDecoder.h"
+
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ROWDECODER_NEON
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define ROWDECODER_SSSE3
+#endif
+
+namespace {
+
+inline QRgb bgrToRgb(const uchar *p) {
+    return qRgb(p[2], p[1], p[0]);
+}
+
+// Rozšíření 5 a 6bitových kanálů na 8 bitů (horní bity se zopakují dole)
+inline int expand5(quint32 value) {
+    return static_cast<int>((value << 3) | (value >> 2));
+}
+
+inline int expand6(quint32 value) {
+    return static_cast<int>((value << 2) | (value >> 4));
+}
+
+#if defined(ROWDECODER_NEON)
+
+void bgrToXrgbSimd(const uchar *src, int pixels, QRgb *dst) {
+    int x = 0;
+    // vld3 rozdělí 48 bajtů na kanály B, G, R, vst4 je uloží zpět s alfou
+    for (; x + 16 <= pixels; x += 16) {
+        uint8x16x3_t bgr = vld3q_u8(src + x * 3);
+        uint8x16x4_t bgra;
+        bgra.val[0] = bgr.val[0];
+        bgra.val[1] = bgr.val[1];
+        bgra.val[2] = bgr.val[2];
+        bgra.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(reinterpret_cast<uint8_t *>(dst + x), bgra);
+    }
+    for (; x < pixels; x++) {
+        dst[x] = bgrToRgb(src + x * 3);
+    }
+}
+
+bool hasSimd() {
+    return true;
+}
+
+#elif defined(ROWDECODER_SSSE3)
+
+__attribute__((target("ssse3")))
+void bgrToXrgbSimd(const uchar *src, int pixels, QRgb *dst) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+    int x = 0;
+    // Načítá se 16 bajtů, ale použije se jen 12 (4 pixely) - poslední
+    // pixely řádku se proto dopočítají skalárně, aby se nečetlo za konec dat
+    for (; x + 6 <= pixels; x += 4) {
+        __m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        __m128i xrgb = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), xrgb);
+    }
+    for (; x < pixels; x++) {
+        dst[x] = bgrToRgb(src + x * 3);
+    }
+}
+
+bool hasSimd() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+#else
+
+void bgrToXrgbSimd(const uchar *src, int pixels, QRgb *dst) {
+    for (int x = 0; x < pixels; x++) {
+        dst[x] = bgrToRgb(src + x * 3);
+    }
+}
+
+bool hasSimd() {
+    return false;
+}
+
+#endif
+
+} // namespace
+
+RowDecoder::RowDecoder(int bitsPerPixel, int width, const QVector<QRgb> &palette, const BitFields &masks)
+    : imageBitsPerPixel(bitsPerPixel), imageWidth(width), kernel(nullptr),
+      redChannel(BitFields::Channel::fromMask(masks.red)), greenChannel(BitFields::Channel::fromMask(masks.green)),
+      blueChannel(BitFields::Channel::fromMask(masks.blue)), alphaChannel(BitFields::Channel::fromMask(masks.alpha)) {
+    const QRgb black = qRgb(0, 0, 0);
+
+    switch (imageBitsPerPixel) {
+        case 32:
+        case 16:
+            if (!masks.isValid(imageBitsPerPixel)) {
+                break;
+            }
+            switch (masks.layout(imageBitsPerPixel)) {
+                case BitFields::Rgb555: kernel = &RowDecoder::decode555; break;
+                case BitFields::Rgb565: kernel = &RowDecoder::decode565; break;
+                case BitFields::Xrgb8888: kernel = &RowDecoder::decodeXrgb32; break;
+                case BitFields::Argb8888: kernel = &RowDecoder::decodeArgb32; break;
+                case BitFields::Generic: kernel = &RowDecoder::decodeBitfields; break;
+            }
+            break;
+        case 24:
+            kernel = hasSimd() ? &RowDecoder::decode24Simd : &RowDecoder::decode24;
+            break;
+        case 8:
+            table.resize(256);
+            for (int i = 0; i < 256; i++) {
+                table[i] = palette.value(i, black);
+            }
+            kernel = &RowDecoder::decode8;
+            break;
+        case 4:
+            // Horní 4 bity jsou první pixel, dolní 4 bity druhý
+            table.resize(256 * 2);
+            for (int i = 0; i < 256; i++) {
+                table[i * 2] = palette.value((i >> 4) & 0x0F, black);
+                table[i * 2 + 1] = palette.value(i & 0x0F, black);
+            }
+            kernel = &RowDecoder::decode4;
+            break;
+        case 1:
+            // Nejvyšší bit je první pixel
+            table.resize(256 * 8);
+            for (int i = 0; i < 256; i++) {
+                for (int bit = 0; bit < 8; bit++) {
+                    table[i * 8 + bit] = palette.value((i >> (7 - bit)) & 0x01, black);
+                }
+            }
+            kernel = &RowDecoder::decode1;
+            break;
+        default:
+            break;  // Nepodporovaný formát - řádek bude černý
+    }
+}
+
+bool RowDecoder::hasAlpha() const {
+    return kernel != nullptr && alphaChannel.bits > 0;
+}
+
+void RowDecoder::decodeRow(const uchar *src, qint64 available, QRgb *dst) const {
+    if (imageWidth <= 0) {
+        return;
+    }
+
+    int pixels = validPixels(available);
+    if (pixels > 0) {
+        (this->*kernel)(src, pixels, dst);
+    }
+    std::fill(dst + pixels, dst + imageWidth, qRgb(0, 0, 0));
+}
+
+void RowDecoder::decodeIndices(const uchar *src, int bitsPerPixel, int width, uchar *dst) {
+    if (bitsPerPixel != 4) {
+        // 1 a 8 bitů mají v BMP i v QImage stejné rozložení
+        std::memcpy(dst, src, static_cast<size_t>((static_cast<qint64>(width) * bitsPerPixel + 7) / 8));
+        return;
+    }
+    for (int x = 0; x + 1 < width; x += 2) {
+        const uchar byte = src[x / 2];
+        dst[x] = byte >> 4;
+        dst[x + 1] = byte & 0x0f;
+    }
+    if (width % 2 != 0) {
+        dst[width - 1] = src[width / 2] >> 4;
+    }
+}
+
+int RowDecoder::validPixels(qint64 available) const {
+    if (available <= 0 || kernel == nullptr) {
+        return 0;
+    }
+
+    qint64 pixels = 0;
+    switch (imageBitsPerPixel) {
+        case 32: pixels = available / 4; break;
+        case 24: pixels = available / 3; break;
+        case 16: pixels = available / 2; break;
+        case 8:  pixels = available; break;
+        case 4:  pixels = available * 2; break;
+        case 1:  pixels = available * 8; break;
+        default: break;
+    }
+    return static_cast<int>(qMin<qint64>(pixels, imageWidth));
+}
+
+void RowDecoder::decode1(const uchar *src, int pixels, QRgb *dst) const {
+    const QRgb *expanded = table.constData();
+    int fullBytes = pixels / 8;
+    for (int i = 0; i < fullBytes; i++) {
+        std::memcpy(dst, expanded + src[i] * 8, 8 * sizeof(QRgb));
+        dst += 8;
+    }
+    int rest = pixels % 8;
+    if (rest > 0) {
+        std::memcpy(dst, expanded + src[fullBytes] * 8, rest * sizeof(QRgb));
+    }
+}
+
+void RowDecoder::decode4(const uchar *src, int pixels, QRgb *dst) const {
+    const QRgb *expanded = table.constData();
+    int fullBytes = pixels / 2;
+    for (int i = 0; i < fullBytes; i++) {
+        std::memcpy(dst, expanded + src[i] * 2, 2 * sizeof(QRgb));
+        dst += 2;
+    }
+    if (pixels % 2 != 0) {
+        *dst = expanded[src[fullBytes] * 2];
+    }
+}
+
+void RowDecoder::decode8(const uchar *src, int pixels, QRgb *dst) const {
+    const QRgb *colors = table.constData();
+    for (int x = 0; x < pixels; x++) {
+        dst[x] = colors[src[x]];
+    }
+}
+
+void RowDecoder::decode24(const uchar *src, int pixels, QRgb *dst) const {
+    for (int x = 0; x < pixels; x++) {
+        dst[x] = bgrToRgb(src + x * 3);
+    }
+}
+
+void RowDecoder::decode24Simd(const uchar *src, int pixels, QRgb *dst) const {
+    bgrToXrgbSimd(src, pixels, dst);
+}
+
+void RowDecoder::decode555(const uchar *src, int pixels, QRgb *dst) const {
+    for (int x = 0; x < pixels; x++) {
+        const quint32 pixel = qFromLittleEndian<quint16>(src + x * 2);
+        dst[x] = qRgb(expand5((pixel >> 10) & 0x1f), expand5((pixel >> 5) & 0x1f), expand5(pixel & 0x1f));
+    }
+}
+
+void RowDecoder::decode565(const uchar *src, int pixels, QRgb *dst) const {
+    for (int x = 0; x < pixels; x++) {
+        const quint32 pixel = qFromLittleEndian<quint16>(src + x * 2);
+        dst[x] = qRgb(expand5(pixel >> 11), expand6((pixel >> 5) & 0x3f), expand5(pixel & 0x1f));
+    }
+}
+
+void RowDecoder::decodeXrgb32(const uchar *src, int pixels, QRgb *dst) const {
+    // Bajty B, G, R, X odpovídají QRgb na little-endian; jen se doplní alfa
+    for (int x = 0; x < pixels; x++) {
+        dst[x] = qFromLittleEndian<quint32>(src + x * 4) | 0xff000000u;
+    }
+}
+
+void RowDecoder::decodeArgb32(const uchar *src, int pixels, QRgb *dst) const {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Bajty B, G, R, A jsou přesně rozložení Format_ARGB32
+    std::memcpy(dst, src, static_cast<size_t>(pixels) * sizeof(QRgb));
+#else
+    for (int x = 0; x < pixels; x++) {
+        dst[x] = qFromLittleEndian<quint32>(src + x * 4);
+    }
+#endif
+}
+
+void RowDecoder::decodeBitfields(const uchar *src, int pixels, QRgb *dst) const {
+    const bool wide = imageBitsPerPixel == 32;
+    const bool alpha = alphaChannel.bits > 0;
+    for (int x = 0; x < pixels; x++) {
+        const quint32 pixel = wide ? qFromLittleEndian<quint32>(src + x * 4) : qFromLittleEndian<quint16>(src + x * 2);
+        dst[x] = qRgba(redChannel.read(pixel), greenChannel.read(pixel), blueChannel.read(pixel),
+                       alpha ? alphaChannel.read(pixel) : 0xff);
+    }
+}
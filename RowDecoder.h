@@ -0,0 +1,63 @@
+#ifndef ROWDECODER_H
+#define ROWDECODER_H
+
+#include "BitFields.h"
+
+#include <QRgb>
+#include <QVector>
+
+// Dekodér jednoho řádku BMP dat do formátu QImage::Format_RGB32
+// (s maskou alfa kanálu do QImage::Format_ARGB32).
+// Kernel pro danou bitovou hloubku se vybírá jen jednou - v konstruktoru.
+class RowDecoder {
+public:
+    // 'masks' se použijí jen pro 16 a 32 bitů na pixel
+    RowDecoder(int bitsPerPixel, int width, const QVector<QRgb> &palette, const BitFields &masks = BitFields());
+
+    // Výstup obsahuje alfa kanál (jinak jsou všechny pixely neprůhledné)
+    bool hasAlpha() const;
+
+    // Dekóduje jeden řádek ze 'src' do 'dst' (width pixelů).
+    // 'available' je počet bajtů, které jsou ve zdroji skutečně k dispozici,
+    // pixely mimo dostupná data se vyplní černou barvou.
+    void decodeRow(const uchar *src, qint64 available, QRgb *dst) const;
+
+    // Indexy pixelů bez převodu na barvy: 1 bit zůstává zabalený jako ve
+    // QImage::Format_Mono, 4 a 8 bitů dají jeden bajt na pixel (Format_Indexed8).
+    // Zdroj musí obsahovat celý řádek.
+    static void decodeIndices(const uchar *src, int bitsPerPixel, int width, uchar *dst);
+
+private:
+    typedef void (RowDecoder::*Kernel)(const uchar *src, int pixels, QRgb *dst) const;
+
+    int imageBitsPerPixel;
+    int imageWidth;
+    Kernel kernel;
+
+    // Předpočítaná tabulka barev:
+    //   8 bitů - 1 barva na bajt (256 položek)
+    //   4 bity - 2 barvy na bajt (512 položek)
+    //   1 bit  - 8 barev na bajt (2048 položek)
+    QVector<QRgb> table;
+
+    // Kanály pro obecný převod 16/32bitových pixelů
+    BitFields::Channel redChannel;
+    BitFields::Channel greenChannel;
+    BitFields::Channel blueChannel;
+    BitFields::Channel alphaChannel;
+
+    int validPixels(qint64 available) const;
+
+    void decode1(const uchar *src, int pixels, QRgb *dst) const;
+    void decode4(const uchar *src, int pixels, QRgb *dst) const;
+    void decode8(const uchar *src, int pixels, QRgb *dst) const;
+    void decode24(const uchar *src, int pixels, QRgb *dst) const;
+    void decode24Simd(const uchar *src, int pixels, QRgb *dst) const;
+    void decode555(const uchar *src, int pixels, QRgb *dst) const;
+    void decode565(const uchar *src, int pixels, QRgb *dst) const;
+    void decodeXrgb32(const uchar *src, int pixels, QRgb *dst) const;
+    void decodeArgb32(const uchar *src, int pixels, QRgb *dst) const;
+    void decodeBitfields(const uchar *src, int pixels, QRgb *dst) const;
+};
+
+#endif // ROWDECODER_H
@@ -0,0 +1,120 @@
+#include "RowEncoder.h"
+
+#include <QtEndian>
+#include <cstring>
+
+RowEncoder::RowEncoder(int bitsPerPixel, int width, const QVector<QRgb> &palette, const BitFields &masks)
+    : imageBitsPerPixel(bitsPerPixel), imageWidth(width),
+      mapper(palette, paletteLimit(bitsPerPixel, palette)), layout(masks.layout(bitsPerPixel)),
+      redChannel(BitFields::Channel::fromMask(masks.red)), greenChannel(BitFields::Channel::fromMask(masks.green)),
+      blueChannel(BitFields::Channel::fromMask(masks.blue)), alphaChannel(BitFields::Channel::fromMask(masks.alpha)) {}
+
+int RowEncoder::paletteLimit(int bitsPerPixel, const QVector<QRgb> &palette) {
+    // 4bitový index pojme jen 16 barev, 1bitový jen 2
+    switch (bitsPerPixel) {
+        case 4: return qMin(palette.size(), 16);
+        case 1: return qMin(palette.size(), 2);
+        default: return palette.size();
+    }
+}
+
+void RowEncoder::encodeRow(const QRgb *src, uchar *dst) const {
+    if (imageBitsPerPixel == 24) {
+        // 24 bitů = 3 bajty na pixel (pořadí B, G, R)
+        for (int x = 0; x < imageWidth; x++) {
+            dst[x * 3] = static_cast<uchar>(qBlue(src[x]));
+            dst[x * 3 + 1] = static_cast<uchar>(qGreen(src[x]));
+            dst[x * 3 + 2] = static_cast<uchar>(qRed(src[x]));
+        }
+        return;
+    }
+    if (imageBitsPerPixel == 16 || imageBitsPerPixel == 32) {
+        encodeBitfields(src, dst);
+        return;
+    }
+
+    // Sousední pixely mívají stejnou barvu - poslední výsledek se použije znovu
+    QRgb lastPixel = 0;
+    int lastIndex = -1;
+    for (int x = 0; x < imageWidth; x++) {
+        QRgb pixel = src[x] & 0x00ffffff;  // Alfa kanál se při porovnání nepoužívá
+        if (lastIndex < 0 || pixel != lastPixel) {
+            lastPixel = pixel;
+            lastIndex = mapper.nearest(pixel);
+        }
+
+        if (imageBitsPerPixel == 8) {
+            // 8 bitů = 1 bajt na pixel
+            dst[x] = static_cast<uchar>(lastIndex);
+        }
+        else if (imageBitsPerPixel == 4) {
+            // 4 bity = 2 pixely na bajt, první pixel v horních 4 bitech
+            dst[x / 2] |= static_cast<uchar>((x % 2 == 0) ? lastIndex << 4 : lastIndex);
+        }
+        else if (imageBitsPerPixel == 1 && lastIndex != 0) {
+            // 1 bit = 8 pixelů na bajt, první pixel v nejvyšším bitu
+            dst[x / 8] |= static_cast<uchar>(1 << (7 - (x % 8)));
+        }
+    }
+}
+
+void RowEncoder::encodeIndices(const uchar *src, int bitsPerPixel, int width, uchar *dst) {
+    if (bitsPerPixel != 4) {
+        std::memcpy(dst, src, static_cast<size_t>((static_cast<qint64>(width) * bitsPerPixel + 7) / 8));
+        return;
+    }
+    for (int x = 0; x + 1 < width; x += 2) {
+        dst[x / 2] = static_cast<uchar>((src[x] << 4) | (src[x + 1] & 0x0f));
+    }
+    if (width % 2 != 0) {
+        dst[width / 2] = static_cast<uchar>(src[width - 1] << 4);
+    }
+}
+
+void RowEncoder::encodeBitfields(const QRgb *src, uchar *dst) const {
+    switch (layout) {
+        case BitFields::Rgb555:
+            for (int x = 0; x < imageWidth; x++) {
+                const QRgb pixel = src[x];
+                qToLittleEndian<quint16>(static_cast<quint16>(((qRed(pixel) >> 3) << 10) | ((qGreen(pixel) >> 3) << 5) |
+                                                              (qBlue(pixel) >> 3)), dst + x * 2);
+            }
+            return;
+        case BitFields::Rgb565:
+            for (int x = 0; x < imageWidth; x++) {
+                const QRgb pixel = src[x];
+                qToLittleEndian<quint16>(static_cast<quint16>(((qRed(pixel) >> 3) << 11) | ((qGreen(pixel) >> 2) << 5) |
+                                                              (qBlue(pixel) >> 3)), dst + x * 2);
+            }
+            return;
+        case BitFields::Xrgb8888:
+            // Nevyužitý horní bajt zůstává nulový
+            for (int x = 0; x < imageWidth; x++) {
+                qToLittleEndian<quint32>(src[x] & 0x00ffffffu, dst + x * 4);
+            }
+            return;
+        case BitFields::Argb8888:
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            std::memcpy(dst, src, static_cast<size_t>(imageWidth) * sizeof(QRgb));
+#else
+            for (int x = 0; x < imageWidth; x++) {
+                qToLittleEndian<quint32>(src[x], dst + x * 4);
+            }
+#endif
+            return;
+        case BitFields::Generic:
+            break;
+    }
+
+    const bool wide = imageBitsPerPixel == 32;
+    for (int x = 0; x < imageWidth; x++) {
+        const QRgb pixel = src[x];
+        const quint32 value = redChannel.write(qRed(pixel)) | greenChannel.write(qGreen(pixel)) |
+                              blueChannel.write(qBlue(pixel)) | alphaChannel.write(qAlpha(pixel));
+        if (wide) {
+            qToLittleEndian<quint32>(value, dst + x * 4);
+        } else {
+            qToLittleEndian<quint16>(static_cast<quint16>(value), dst + x * 2);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef ROWENCODER_H
+#define ROWENCODER_H
+
+#include "BitFields.h"
+#include "PaletteMapper.h"
+
+#include <QRgb>
+#include <QVector>
+
+// Kodér jednoho řádku pixelů (QRgb) zpět do BMP formátu dané bitové hloubky.
+// Pro obrázky s paletou se hledá nejbližší barva v paletě (PaletteMapper),
+// 16 a 32bitové pixely se skládají podle masek kanálů.
+class RowEncoder {
+public:
+    RowEncoder(int bitsPerPixel, int width, const QVector<QRgb> &palette, const BitFields &masks = BitFields());
+
+    // Zakóduje 'width' pixelů ze 'src' do 'dst'. Cílový řádek musí být
+    // předem vynulovaný (včetně zarovnání na 4 bajty).
+    void encodeRow(const QRgb *src, uchar *dst) const;
+
+    // Opak RowDecoder::decodeIndices - indexy z řádku Format_Mono/Format_Indexed8
+    // se zapíšou beze změny, bez hledání barev v paletě
+    static void encodeIndices(const uchar *src, int bitsPerPixel, int width, uchar *dst);
+
+private:
+    int imageBitsPerPixel;
+    int imageWidth;
+    PaletteMapper mapper;
+    BitFields::Layout layout;
+    BitFields::Channel redChannel;
+    BitFields::Channel greenChannel;
+    BitFields::Channel blueChannel;
+    BitFields::Channel alphaChannel;
+
+    static int paletteLimit(int bitsPerPixel, const QVector<QRgb> &palette);
+    void encodeBitfields(const QRgb *src, uchar *dst) const;
+};
+
+#endif // ROWENCODER_H
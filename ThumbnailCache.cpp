@@ -0,0 +1,176 @@
+#include "ThumbnailCache.h"
+#include "Image.h"
+#include "TiledImageStore.h"
+#include "Trace.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#if defined(Q_OS_UNIX)
+#include <utime.h>
+#elif defined(Q_OS_WIN)
+#include <sys/utime.h>
+#endif
+
+namespace {
+
+const quint32 CacheMagic = 0x424d5054;  // "BMPT"
+const quint32 CacheVersion = 1;
+
+// Použití zmenšeniny se zaznamená jako čas změny jejího souboru - čas
+// posledního přístupu systém často neaktualizuje (noatime, relatime)
+void markUsed(const QString &path) {
+#if defined(Q_OS_UNIX)
+    ::utime(QFile::encodeName(path).constData(), nullptr);
+#elif defined(Q_OS_WIN)
+    ::_wutime(reinterpret_cast<const wchar_t*>(path.utf16()), nullptr);
+#else
+    Q_UNUSED(path);
+#endif
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(const QString &directory, int size, qint64 maxBytes)
+    : cacheDirectory(directory), thumbnailSize(qMax(1, size)), cacheLimit(maxBytes), writesSincePrune(0) {
+    if (!cacheDirectory.isEmpty()) {
+        QDir().mkpath(cacheDirectory);
+        prune();
+    }
+}
+
+QImage ThumbnailCache::thumbnail(const QString &filePath) const {
+    const QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return QImage();
+    }
+    const qint64 fileSize = fileInfo.size();
+    const qint64 modifiedMs = fileInfo.lastModified().toMSecsSinceEpoch();
+    const QString cachePath = cacheDirectory.isEmpty() ? QString() : cacheFile(fileInfo.absoluteFilePath());
+
+    // Uložená zmenšenina platí jen pro stejnou verzi souboru a stejnou velikost zmenšeniny
+    if (!cachePath.isEmpty()) {
+        QFile file(cachePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            BMP_TRACE_SCOPE("thumbnail cache read");
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_0);
+            quint32 magic = 0, version = 0;
+            qint64 cachedSize = 0, cachedModifiedMs = 0;
+            qint32 cachedThumbnailSize = 0;
+            stream >> magic >> version >> cachedSize >> cachedModifiedMs >> cachedThumbnailSize;
+            if (stream.status() == QDataStream::Ok && magic == CacheMagic && version == CacheVersion &&
+                cachedSize == fileSize && cachedModifiedMs == modifiedMs && cachedThumbnailSize == thumbnailSize) {
+                QImage image;
+                stream >> image;
+                if (stream.status() == QDataStream::Ok && !image.isNull()) {
+                    file.close();
+                    markUsed(cachePath);
+                    return image;
+                }
+            }
+        }
+    }
+
+    const QImage image = decode(filePath, thumbnailSize);
+    if (image.isNull() || cachePath.isEmpty()) {
+        return image;
+    }
+
+    // Dočasný soubor a přejmenování - souběžné čtení nikdy nevidí rozepsanou zmenšeninu
+    QSaveFile file(cachePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        BMP_TRACE_SCOPE("thumbnail cache write");
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << CacheMagic << CacheVersion << fileSize << modifiedMs << qint32(thumbnailSize) << image;
+        if (stream.status() == QDataStream::Ok && file.commit() &&
+            ++writesSincePrune >= PruneInterval) {
+            prune();
+        }
+    }
+    return image;
+}
+
+void ThumbnailCache::prune() const {
+    if (cacheDirectory.isEmpty()) {
+        return;
+    }
+    // Souběžné pročištění z jiného vlákna udělá totéž
+    if (!pruneMutex.tryLock()) {
+        return;
+    }
+    BMP_TRACE_SCOPE("thumbnail cache prune");
+    writesSincePrune = 0;
+
+    // Od naposledy použitých - ponechají se, dokud se vejdou do limitu
+    const QFileInfoList entries = QDir(cacheDirectory).entryInfoList(QStringList() << "*.thumb",
+                                                                     QDir::Files, QDir::Time);
+    qint64 bytes = 0;
+    for (const QFileInfo &entry : entries) {
+        bytes += entry.size();
+        if (bytes > cacheLimit) {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+    pruneMutex.unlock();
+}
+
+QImage ThumbnailCache::decode(const QString &filePath, int size) {
+    BMP_TRACE_SCOPE("thumbnail decode");
+
+    // Po dlaždicích se soubor jen namapuje - pixely se čtou až při vzorkování
+    Image image;
+    if (!image.loadFromFile(filePath, Image::LoadMode::Tiled)) {
+        return QImage();
+    }
+    const std::shared_ptr<const TiledImageStore> tiles = image.tiles();
+    if (!tiles || tiles->width() <= 0 || tiles->height() <= 0) {
+        return QImage();
+    }
+
+    QSize target = tiles->size();
+    if (target.width() > size || target.height() > size) {
+        target = target.scaled(size, size, Qt::KeepAspectRatio);
+    }
+    target = target.expandedTo(QSize(1, 1));
+
+    // Vzorkuje se dvojnásobek cílových rozměrů a výsledek se vyhladí - jeden
+    // vzorek na pixel by u jemných vzorů a šumu dával zubaté zmenšeniny
+    const QSize sampled(qMin(tiles->width(), 2 * target.width()), qMin(tiles->height(), 2 * target.height()));
+    QVector<int> columns(sampled.width());
+    for (int x = 0; x < sampled.width(); x++) {
+        columns[x] = static_cast<int>((2LL * x + 1) * tiles->width() / (2LL * sampled.width()));
+    }
+
+    QImage result(sampled, QImage::Format_RGB32);
+    if (result.isNull()) {
+        return result;
+    }
+    for (int y = 0; y < sampled.height(); y++) {
+        const int row = static_cast<int>((2LL * y + 1) * tiles->height() / (2LL * sampled.height()));
+        tiles->sampleRow(row, columns, reinterpret_cast<QRgb*>(result.scanLine(y)));
+    }
+    return sampled == target ? result : result.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QString ThumbnailCache::defaultDirectory() {
+    const QString configured = QString::fromLocal8Bit(qgetenv("BMPEDITOR_THUMBNAIL_CACHE"));
+    if (!configured.isEmpty()) {
+        return configured;
+    }
+    const QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return location.isEmpty() ? QString() : QDir(location).filePath("thumbnails");
+}
+
+QString ThumbnailCache::cacheFile(const QString &absolutePath) const {
+    const QByteArray hash = QCryptographicHash::hash(absolutePath.toUtf8(), QCryptographicHash::Sha1);
+    return QDir(cacheDirectory).filePath(QString::fromLatin1(hash.toHex()) + ".thumb");
+}
@@ -0,0 +1,54 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+// Zmenšeniny BMP souborů pro procházení složky. Zmenšenina se dekóduje jen
+// z vybraných řádků a sloupců namapovaného souboru (celý obrázek se
+// nedekóduje) a ukládá se do adresáře cache - platí, dokud se nezmění
+// velikost a čas změny zdrojového souboru. Adresář cache má horní mez
+// velikosti - při překročení se mažou nejdéle nepoužité zmenšeniny (čas
+// změny souboru zmenšeniny se při každém použití obnoví). Metody lze volat
+// z více vláken.
+class ThumbnailCache {
+public:
+    static const int DefaultSize = 96;
+    static const qint64 DefaultMaxBytes = 64LL * 1024 * 1024;
+
+    // Prázdný adresář = zmenšeniny se jen dekódují, neukládají. Přebytečné
+    // zmenšeniny z minulých spuštění se smažou hned při vytvoření.
+    explicit ThumbnailCache(const QString &directory = defaultDirectory(), int size = DefaultSize,
+                            qint64 maxBytes = DefaultMaxBytes);
+
+    // Zmenšenina z cache, jinak se dekóduje a uloží (null = soubor nelze načíst)
+    QImage thumbnail(const QString &filePath) const;
+
+    int size() const { return thumbnailSize; }
+    QString directory() const { return cacheDirectory; }
+
+    // Smaže nejdéle nepoužité zmenšeniny, dokud adresář nepřesahuje limit
+    void prune() const;
+
+    // Zmenšenina nejvýš size x size pixelů (menší obrázky se nezvětšují)
+    static QImage decode(const QString &filePath, int size);
+    // Proměnná prostředí BMPEDITOR_THUMBNAIL_CACHE, jinak podadresář
+    // "thumbnails" v systémové cache aplikace
+    static QString defaultDirectory();
+
+private:
+    // Po tolika nově uložených zmenšeninách se adresář znovu pročistí
+    static const int PruneInterval = 64;
+
+    QString cacheDirectory;
+    int thumbnailSize;
+    qint64 cacheLimit;
+    mutable std::atomic<int> writesSincePrune;
+    mutable QMutex pruneMutex;
+
+    QString cacheFile(const QString &absolutePath) const;
+};
+
+#endif // THUMBNAILCACHE_H
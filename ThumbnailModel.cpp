@@ -0,0 +1,137 @@
+#include "ThumbnailModel.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <functional>
+
+namespace {
+
+class DecodeTask : public QRunnable {
+public:
+    explicit DecodeTask(std::function<void()> task) : task(std::move(task)) {}
+    void run() override { task(); }
+
+private:
+    std::function<void()> task;
+};
+
+} // namespace
+
+ThumbnailModel::ThumbnailModel(QObject *parent)
+    : QAbstractListModel(parent), generation(0), pixmaps(PixmapCacheKb) {
+    placeholder = QPixmap(cache.size(), cache.size());
+    placeholder.fill(Qt::transparent);
+
+    // Jedno vlákno zůstane volné pro načítání a filtry otevřeného obrázku
+    workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+    connect(this, &ThumbnailModel::thumbnailDecoded, this, &ThumbnailModel::onThumbnailDecoded,
+            Qt::QueuedConnection);
+}
+
+ThumbnailModel::~ThumbnailModel() {
+    {
+        QMutexLocker locker(&queueMutex);
+        queue.clear();
+    }
+    workerPool.waitForDone();
+}
+
+void ThumbnailModel::setFolder(const QString &directory) {
+    beginResetModel();
+    {
+        QMutexLocker locker(&queueMutex);
+        queue.clear();
+        generation++;
+    }
+    pending.clear();
+    pixmaps.clear();
+
+    QDir dir(directory);
+    folderPath = dir.absolutePath();
+    files.clear();
+    const QStringList names = dir.entryList(QStringList() << "*.bmp", QDir::Files | QDir::Readable,
+                                            QDir::Name | QDir::IgnoreCase);
+    files.reserve(names.size());
+    for (const QString &name : names) {
+        files.append(dir.absoluteFilePath(name));
+    }
+    endResetModel();
+}
+
+QString ThumbnailModel::filePath(const QModelIndex &index) const {
+    return index.isValid() && index.row() < files.size() ? files[index.row()] : QString();
+}
+
+int ThumbnailModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : files.size();
+}
+
+QVariant ThumbnailModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= files.size()) {
+        return QVariant();
+    }
+    const int row = index.row();
+    switch (role) {
+        case Qt::DisplayRole:
+            return QFileInfo(files[row]).fileName();
+        case Qt::ToolTipRole:
+            return files[row];
+        case Qt::DecorationRole: {
+            const QPixmap *pixmap = pixmaps.object(row);
+            if (!pixmap) {
+                request(row);
+                return placeholder;
+            }
+            return pixmap->isNull() ? placeholder : *pixmap;
+        }
+        default:
+            return QVariant();
+    }
+}
+
+void ThumbnailModel::request(int row) const {
+    if (pending.contains(row)) {
+        return;
+    }
+    pending.insert(row);
+    {
+        QMutexLocker locker(&queueMutex);
+        queue.append({generation, row, files[row]});
+        if (queue.size() > MaxQueuedRequests) {
+            // Řádek se při příštím vykreslení vyžádá znovu
+            pending.remove(queue.first().row);
+            queue.removeFirst();
+        }
+    }
+    // Úloha si vezme nejnovější požadavek, ne nutně tento
+    ThumbnailModel *model = const_cast<ThumbnailModel*>(this);
+    workerPool.start(new DecodeTask([model]() { model->decodeNext(); }));
+}
+
+void ThumbnailModel::decodeNext() {
+    Request next;
+    {
+        QMutexLocker locker(&queueMutex);
+        if (queue.isEmpty()) {
+            return;  // Požadavek byl zahozen nebo už ho vyřídila jiná úloha
+        }
+        next = queue.takeLast();
+    }
+    emit thumbnailDecoded(next.generation, next.row, cache.thumbnail(next.path));
+}
+
+void ThumbnailModel::onThumbnailDecoded(quint64 decodedGeneration, int row, const QImage &image) {
+    if (decodedGeneration != generation || row >= files.size()) {
+        return;
+    }
+    pending.remove(row);
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+    pixmaps.insert(row, pixmap, qMax(1, pixmap->width() * pixmap->height() * 4 / 1024));
+
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, QVector<int>() << Qt::DecorationRole);
+}
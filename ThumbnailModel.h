@@ -0,0 +1,73 @@
+#ifndef THUMBNAILMODEL_H
+#define THUMBNAILMODEL_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QPixmap>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "ThumbnailCache.h"
+
+// BMP soubory jedné složky se zmenšeninami pro QListView. Zmenšenina se
+// vyžádá, až ji pohled poprvé vykresluje, a vytvoří se v pracovních vláknech
+// (do té doby se zobrazuje prázdný zástupný obrázek). Novější požadavky mají
+// přednost a nejstarší se zahazují - při rychlém posouvání se tak dekódují
+// řádky, které jsou právě vidět, a ne ty, přes které se už přejelo.
+class ThumbnailModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit ThumbnailModel(QObject *parent = nullptr);
+    ~ThumbnailModel() override;
+
+    void setFolder(const QString &directory);
+    QString folder() const { return folderPath; }
+    QString filePath(const QModelIndex &index) const;
+    int thumbnailSize() const { return cache.size(); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+signals:
+    // Interní signál z pracovního vlákna (doručí se do GUI vlákna frontou)
+    void thumbnailDecoded(quint64 generation, int row, const QImage &image);
+
+private slots:
+    void onThumbnailDecoded(quint64 generation, int row, const QImage &image);
+
+private:
+    // Nejvýš tolik nevyřízených požadavků - starší už nejsou vidět
+    static const int MaxQueuedRequests = 512;
+    // Limit hotových zmenšenin v paměti (cena v kB)
+    static const int PixmapCacheKb = 64 * 1024;
+
+    struct Request {
+        quint64 generation;
+        int row;
+        QString path;
+    };
+
+    ThumbnailCache cache;
+    QString folderPath;
+    QStringList files;
+    QPixmap placeholder;
+    quint64 generation;  // Zvyšuje se se změnou složky - staré výsledky se zahodí
+
+    // Vyžádání zmenšeniny z data() mění jen tyto pomocné struktury
+    mutable QCache<int, QPixmap> pixmaps;  // null = soubor nelze načíst
+    mutable QSet<int> pending;             // Řádky ve frontě nebo v dekódování
+
+    mutable QMutex queueMutex;
+    mutable QVector<Request> queue;  // Zpracovává se od konce (nejnovější první)
+    mutable QThreadPool workerPool;
+
+    void request(int row) const;
+    void decodeNext();
+};
+
+#endif // THUMBNAILMODEL_H
@@ -0,0 +1,214 @@
+#include "TiledImageStore.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "RowDecoder.h"
+#include "Trace.h"
+
+#include <QMutexLocker>
+#include <atomic>
+
+namespace {
+
+const qint64 DefaultCacheLimit = 256LL * 1024 * 1024;
+
+std::atomic<qint64> configuredCacheLimit(0);
+
+} // namespace
+
+TiledImageStore::TiledImageStore(const QByteArray &rows, int width, int height, int bitsPerPixel,
+                                 const QVector<QRgb> &palette, const BitFields &masks, bool bottomUp)
+    : TiledImageStore(nullptr, 0, 0, width, height, bitsPerPixel, palette, masks, bottomUp) {
+    rawRows = rows;
+}
+
+TiledImageStore::TiledImageStore(std::shared_ptr<MappedFile> mapping, qint64 rowsOffset, qint64 rowsSize, int width,
+                                 int height, int bitsPerPixel, const QVector<QRgb> &palette, const BitFields &masks,
+                                 bool bottomUp)
+    : mappedFile(std::move(mapping)), sourceLost(false), mappedOffset(rowsOffset), mappedSize(rowsSize), imageWidth(width),
+      imageHeight(height), imageBitsPerPixel(bitsPerPixel), colorPalette(palette), channelMasks(masks),
+      bottomUp(bottomUp), bytesPerRow(Image::calculateRowSize(width, bitsPerPixel)) {
+    tiles.setMaxCost(static_cast<int>(qMin<qint64>(cacheLimit() / 1024, INT_MAX)));
+}
+
+void TiledImageStore::setCacheLimit(qint64 bytes) {
+    configuredCacheLimit = bytes;
+}
+
+qint64 TiledImageStore::cacheLimit() {
+    qint64 limit = configuredCacheLimit;
+    if (limit > 0) {
+        return limit;
+    }
+    int megabytes = qEnvironmentVariableIntValue("BMPEDITOR_TILE_CACHE_MB");
+    return megabytes > 0 ? megabytes * 1024LL * 1024 : DefaultCacheLimit;
+}
+
+qint64 TiledImageStore::cachedBytes() const {
+    QMutexLocker locker(&mutex);
+    return static_cast<qint64>(tiles.totalCost()) * 1024;  // Cena je v kB
+}
+
+QImage TiledImageStore::tile(int column, int row) const {
+    const quint64 key = (static_cast<quint64>(row) << 32) | static_cast<quint32>(column);
+    {
+        QMutexLocker locker(&mutex);
+        if (QImage *cached = tiles.object(key)) {
+            return *cached;
+        }
+    }
+
+    // Dekóduje se mimo zámek - souběžné dekódování stejné dlaždice jen zbytečně
+    // proběhne dvakrát, výsledek je stejný
+    QImage decoded = decodeTile(column, row);
+    if (!decoded.isNull()) {
+        QMutexLocker locker(&mutex);
+        int cost = static_cast<int>(qMax<qint64>(1, static_cast<qint64>(decoded.bytesPerLine()) * decoded.height() / 1024));
+        tiles.insert(key, new QImage(decoded), cost);
+    }
+    return decoded;
+}
+
+QImage TiledImageStore::decodeTile(int column, int row) const {
+    BMP_TRACE_SCOPE("decode tile");
+    const int left = column * TileSize;
+    const int top = row * TileSize;
+    const int tileWidth = qMin(TileSize, imageWidth - left);
+    const int tileHeight = qMin(TileSize, imageHeight - top);
+    if (tileWidth <= 0 || tileHeight <= 0) {
+        return QImage();
+    }
+
+    // Levý okraj dlaždice je násobkem 256 pixelů, začíná tedy vždy na celém bajtu
+    const RowDecoder decoder(imageBitsPerPixel, tileWidth, colorPalette, channelMasks);
+    QImage result(tileWidth, tileHeight, decoder.hasAlpha() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    if (result.isNull()) {
+        return result;
+    }
+    BMP_TRACE_BYTES(qint64(result.bytesPerLine()) * tileHeight);
+
+    const qint64 columnOffset = static_cast<qint64>(left) * imageBitsPerPixel / 8;
+    const Rows rows = currentRows();
+
+    for (int y = 0; y < tileHeight; y++) {
+        int imageRow = top + y;
+        int storedRow = bottomUp ? imageHeight - 1 - imageRow : imageRow;
+        qint64 offset = storedRow * bytesPerRow + columnOffset;
+        qint64 available = rows.size - offset;
+        decoder.decodeRow(available > 0 ? rows.data + offset : nullptr, available,
+                          reinterpret_cast<QRgb*>(result.scanLine(y)));
+    }
+    return result;
+}
+
+QImage TiledImageStore::copy(const QRect &rect) const {
+    const QRect area = rect.intersected(QRect(0, 0, imageWidth, imageHeight));
+    QImage result(area.size(), channelMasks.hasAlpha() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    if (area.isEmpty() || result.isNull()) {
+        return result;
+    }
+
+    for (int row = area.top() / TileSize; row <= area.bottom() / TileSize; row++) {
+        for (int column = area.left() / TileSize; column <= area.right() / TileSize; column++) {
+            const QImage source = tile(column, row);
+            const QRect tileRect(column * TileSize, row * TileSize, source.width(), source.height());
+            const QRect part = tileRect.intersected(area);
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                const QRgb *in = reinterpret_cast<const QRgb*>(source.constScanLine(y - tileRect.top()));
+                QRgb *out = reinterpret_cast<QRgb*>(result.scanLine(y - area.top()));
+                memcpy(out + (part.left() - area.left()), in + (part.left() - tileRect.left()),
+                       part.width() * sizeof(QRgb));
+            }
+        }
+    }
+    return result;
+}
+
+void TiledImageStore::sampleRow(int y, const QVector<int> &columns, QRgb *out) const {
+    const Rows rows = currentRows();
+    const int storedRow = bottomUp ? imageHeight - 1 - y : y;
+    const qint64 rowOffset = storedRow * bytesPerRow;
+    const uchar *data = rows.data;
+
+    if (imageBitsPerPixel == 16 || imageBitsPerPixel == 32) {
+        // Pixely s maskami kanálů převádí stejný kernel jako celé řádky (alfa se nezobrazuje)
+        const RowDecoder decoder(imageBitsPerPixel, 1, colorPalette, channelMasks);
+        const int bytesPerPixel = imageBitsPerPixel / 8;
+        for (int i = 0; i < columns.size(); i++) {
+            const qint64 offset = rowOffset + qint64(columns[i]) * bytesPerPixel;
+            const qint64 available = rows.size - offset;
+            decoder.decodeRow(available > 0 ? data + offset : nullptr, available, out + i);
+            out[i] |= 0xff000000;
+        }
+        return;
+    }
+
+    for (int i = 0; i < columns.size(); i++) {
+        out[i] = pixel(data, rows.size, rowOffset, columns[i]);
+    }
+}
+
+QRgb TiledImageStore::pixel(const uchar *data, qint64 dataSize, qint64 rowOffset, int x) const {
+    // Pixely mimo dostupná data a indexy mimo paletu jsou černé (jako v RowDecoder)
+    int index = 0;
+    switch (imageBitsPerPixel) {
+        case 24: {
+            qint64 offset = rowOffset + x * 3LL;
+            if (offset + 3 > dataSize) return qRgb(0, 0, 0);
+            return qRgb(data[offset + 2], data[offset + 1], data[offset]);
+        }
+        case 8: {
+            qint64 offset = rowOffset + x;
+            if (offset >= dataSize) return qRgb(0, 0, 0);
+            index = data[offset];
+            break;
+        }
+        case 4: {
+            qint64 offset = rowOffset + x / 2;
+            if (offset >= dataSize) return qRgb(0, 0, 0);
+            index = (x % 2 == 0) ? data[offset] >> 4 : data[offset] & 0x0f;
+            break;
+        }
+        case 1: {
+            qint64 offset = rowOffset + x / 8;
+            if (offset >= dataSize) return qRgb(0, 0, 0);
+            index = (data[offset] >> (7 - x % 8)) & 1;
+            break;
+        }
+        default:
+            return qRgb(0, 0, 0);
+    }
+    return index < colorPalette.size() ? colorPalette[index] : qRgb(0, 0, 0);
+}
+
+TiledImageStore::Rows TiledImageStore::currentRows() const {
+    // Data (i mapování, do kterého ukazují) se drží po celou dobu čtení
+    Rows rows;
+    QMutexLocker locker(&mutex);
+    // Dlaždice se dekódují při vykreslování dlouho po otevření - soubor zkrácený
+    // na místě by čtení z mapování shodilo (SIGBUS), proto se ověřuje před každým čtením
+    if (mappedFile && !mappedFile->isUnchanged()) {
+        mappedFile.reset();
+        sourceLost = true;
+    }
+    if (mappedFile) {
+        rows.mapping = mappedFile;
+        rows.data = mappedFile->data() + mappedOffset;
+        rows.size = mappedSize;
+    } else {
+        rows.owned = rawRows;
+        rows.data = reinterpret_cast<const uchar*>(rows.owned.constData());
+        rows.size = rows.owned.size();
+    }
+    return rows;
+}
+
+bool TiledImageStore::isSourceLost() const {
+    QMutexLocker locker(&mutex);
+    return sourceLost;
+}
+
+void TiledImageStore::replaceRows(const QByteArray &rows) {
+    QMutexLocker locker(&mutex);
+    rawRows = rows;
+    mappedFile.reset();
+}
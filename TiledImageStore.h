@@ -0,0 +1,90 @@
+#ifndef TILEDIMAGESTORE_H
+#define TILEDIMAGESTORE_H
+
+#include "BitFields.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QVector>
+#include <memory>
+
+class MappedFile;
+
+// Obrázek uložený jako dlaždice 256x256 pixelů, které se dekódují z BMP
+// řádků (typicky přímo z namapovaného souboru) až ve chvíli, kdy jsou potřeba.
+// Dekódované dlaždice drží LRU cache s omezenou velikostí, takže paměť
+// odpovídá zobrazené části, ne velikosti souboru. Řádky v mapování se
+// adresují 64bitově - soubor může být větší než QByteArray (2 GB).
+class TiledImageStore {
+public:
+    static const int TileSize = 256;
+
+    // 'rows' jsou pixelová data BMP (řádky zarovnané na 4 bajty)
+    TiledImageStore(const QByteArray &rows, int width, int height, int bitsPerPixel, const QVector<QRgb> &palette,
+                    const BitFields &masks, bool bottomUp);
+    // Pixelová data začínají v namapovaném souboru na 'rowsOffset' a mají 'rowsSize' bajtů
+    TiledImageStore(std::shared_ptr<MappedFile> mapping, qint64 rowsOffset, qint64 rowsSize, int width, int height,
+                    int bitsPerPixel, const QVector<QRgb> &palette, const BitFields &masks, bool bottomUp);
+
+    int width() const { return imageWidth; }
+    int height() const { return imageHeight; }
+    QSize size() const { return QSize(imageWidth, imageHeight); }
+
+    // Dekódovaná dlaždice (Format_RGB32, s maskou alfy Format_ARGB32), poslední může být menší
+    QImage tile(int column, int row) const;
+
+    // Výřez obrázku složený z dlaždic
+    QImage copy(const QRect &rect) const;
+
+    // Vybrané pixely řádku 'y' přímo z BMP dat, bez dekódování dlaždic
+    // (řídké vzorkování při oddálení)
+    void sampleRow(int y, const QVector<int> &columns, QRgb *out) const;
+
+    // Paměť, kterou právě zabírají dekódované dlaždice
+    qint64 cachedBytes() const;
+
+    // Namapovaný zdrojový soubor se změnil na místě (např. zkrácením) - z mapování
+    // se už nečte a nové dlaždice jsou černé, obrázek je potřeba zavřít nebo načíst znovu
+    bool isSourceLost() const;
+
+    // Nahrazení dat stejného obsahu (např. kopií před přepsáním zdrojového souboru)
+    void replaceRows(const QByteArray &rows);
+
+    // Limit dekódovaných dlaždic v bajtech pro nově vytvořená úložiště
+    // (0 = proměnná prostředí BMPEDITOR_TILE_CACHE_MB, jinak 256 MB)
+    static void setCacheLimit(qint64 bytes);
+    static qint64 cacheLimit();
+
+private:
+    // Data, ze kterých se právě čte - drží i mapování, do kterého 'data' ukazuje
+    struct Rows {
+        QByteArray owned;
+        std::shared_ptr<MappedFile> mapping;
+        const uchar *data = nullptr;
+        qint64 size = 0;
+    };
+
+    mutable QMutex mutex;
+    mutable QCache<quint64, QImage> tiles;  // Cena = velikost v kB
+    QByteArray rawRows;
+    mutable std::shared_ptr<MappedFile> mappedFile;  // Uvolní se, jakmile se soubor změní
+    mutable bool sourceLost;
+    qint64 mappedOffset;
+    qint64 mappedSize;
+    int imageWidth;
+    int imageHeight;
+    int imageBitsPerPixel;
+    QVector<QRgb> colorPalette;
+    BitFields channelMasks;
+    bool bottomUp;
+    qint64 bytesPerRow;
+
+    Rows currentRows() const;
+    QImage decodeTile(int column, int row) const;
+    QRgb pixel(const uchar *data, qint64 dataSize, qint64 rowOffset, int x) const;
+};
+
+#endif // TILEDIMAGESTORE_H
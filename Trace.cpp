@@ -0,0 +1,192 @@
+#include "Trace.h"
+
+#ifdef BMPEDITOR_ENABLE_TRACING
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <atomic>
+
+namespace {
+
+// Slot kruhového bufferu. Zapisovatel si atomicky přidělí pořadové číslo
+// úseku; sequence je během zápisu liché a po zápisu 2 * index + 2, takže
+// čtenář pozná rozepsaný nebo mezitím přepsaný slot a přeskočí ho.
+// Zápis ani čtení nepoužívají zámek.
+struct Slot {
+    std::atomic<quint64> sequence;
+    std::atomic<const char*> name;
+    std::atomic<qint64> startNs;
+    std::atomic<qint64> durationNs;
+    std::atomic<qint64> bytes;
+    std::atomic<int> thread;
+};
+
+Slot ringBuffer[Trace::Capacity];
+std::atomic<quint64> nextIndex(0);
+std::atomic<qint64> allocatedBytes(0);
+std::atomic<int> nextThread(1);
+
+thread_local int currentThread = 0;
+thread_local Trace::Scope *currentScope = nullptr;
+
+int threadNumber() {
+    if (currentThread == 0) {
+        currentThread = nextThread++;
+    }
+    return currentThread;
+}
+
+void record(const char *name, qint64 startNs, qint64 durationNs, qint64 bytes) {
+    const quint64 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = ringBuffer[index % Trace::Capacity];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durationNs.store(durationNs, std::memory_order_relaxed);
+    slot.bytes.store(bytes, std::memory_order_relaxed);
+    slot.thread.store(threadNumber(), std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+} // namespace
+
+Trace::Scope::Scope(const char *name)
+    : name(name), startNs(nowNs()), bytes(0), parent(currentScope) {
+    currentScope = this;
+}
+
+Trace::Scope::Scope(const QString &name) : Scope(intern(name)) {}
+
+Trace::Scope::~Scope() {
+    currentScope = parent;
+    record(name, startNs, nowNs() - startNs, bytes);
+}
+
+void Trace::addBytes(qint64 count) {
+    allocatedBytes.fetch_add(count, std::memory_order_relaxed);
+    if (currentScope) {
+        currentScope->addBytes(count);
+    }
+}
+
+qint64 Trace::totalAllocatedBytes() {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+QVector<Trace::Event> Trace::snapshot() {
+    const quint64 end = nextIndex.load(std::memory_order_acquire);
+    const quint64 begin = end > quint64(Capacity) ? end - Capacity : 0;
+
+    QVector<Event> events;
+    events.reserve(static_cast<int>(end - begin));
+    for (quint64 index = begin; index < end; index++) {
+        const Slot &slot = ringBuffer[index % Capacity];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            continue;  // Ještě se zapisuje nebo už byl přepsán novějším úsekem
+        }
+
+        Event event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNs = slot.startNs.load(std::memory_order_relaxed);
+        event.durationNs = slot.durationNs.load(std::memory_order_relaxed);
+        event.bytes = slot.bytes.load(std::memory_order_relaxed);
+        event.thread = slot.thread.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            events.append(event);
+        }
+    }
+    return events;
+}
+
+QVector<Trace::StageSummary> Trace::summarize() {
+    QVector<StageSummary> stages;
+    QHash<const char*, int> stageIndex;
+    for (const Event &event : snapshot()) {
+        int index = stageIndex.value(event.name, -1);
+        if (index < 0) {
+            index = stages.size();
+            stageIndex.insert(event.name, index);
+            stages.append({QString::fromUtf8(event.name), 0, 0, 0, 0, 0});
+        }
+
+        StageSummary &stage = stages[index];
+        stage.count++;
+        stage.lastNs = event.durationNs;
+        stage.averageNs += event.durationNs;  // Zatím součet
+        stage.maxNs = qMax(stage.maxNs, event.durationNs);
+        stage.bytes += event.bytes;
+    }
+
+    for (StageSummary &stage : stages) {
+        stage.averageNs /= stage.count;
+    }
+    return stages;
+}
+
+bool Trace::exportChromeTrace(const QString &filePath) {
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+    for (const Event &event : snapshot()) {
+        QJsonObject object;
+        object["name"] = QString::fromUtf8(event.name);
+        object["cat"] = "bmpeditor";
+        object["ph"] = "X";  // Úplný úsek (začátek + délka)
+        object["ts"] = event.startNs / 1000.0;  // Chrome očekává mikrosekundy
+        object["dur"] = event.durationNs / 1000.0;
+        object["pid"] = pid;
+        object["tid"] = event.thread;
+        if (event.bytes > 0) {
+            QJsonObject args;
+            args["bytes"] = event.bytes;
+            object["args"] = args;
+        }
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    return file.write(json) == json.size();
+}
+
+qint64 Trace::nowNs() {
+    static QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer.nsecsElapsed();
+}
+
+const char* Trace::intern(const QString &name) {
+    static QMutex mutex;
+    static QHash<QString, QByteArray> names;
+
+    QMutexLocker locker(&mutex);
+    if (!names.contains(name)) {
+        names.insert(name, name.toUtf8());
+    }
+    // Data QByteArray se při přeskupení hashe nepřesouvají
+    return names[name].constData();
+}
+
+#endif // BMPEDITOR_ENABLE_TRACING
@@ -0,0 +1,89 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Měření doby zpracování v kritických místech (čtení, dekódování, filtry,
+// kódování, zápis, vykreslení). Zapíná se při překladu volbou
+// BMPEDITOR_ENABLE_TRACING; bez ní se makra přeloží na nic a třída Trace
+// vůbec neexistuje.
+//
+//   BMP_TRACE_SCOPE("decode");          // měří až do konce bloku
+//   BMP_TRACE_SCOPE_NAME(filter.name()); // název známý až za běhu
+//   BMP_TRACE_BYTES(image.bytesPerLine() * image.height()); // alokace v bloku
+
+#ifdef BMPEDITOR_ENABLE_TRACING
+
+#include <QString>
+#include <QVector>
+
+class Trace {
+public:
+    // Jeden změřený úsek (časy v ns od startu aplikace)
+    struct Event {
+        const char *name;
+        qint64 startNs;
+        qint64 durationNs;
+        qint64 bytes;
+        int thread;
+    };
+
+    // Souhrn posledních úseků se stejným názvem
+    struct StageSummary {
+        QString name;
+        int count;
+        qint64 lastNs;
+        qint64 averageNs;
+        qint64 maxNs;
+        qint64 bytes;
+    };
+
+    class Scope {
+    public:
+        explicit Scope(const char *name);
+        explicit Scope(const QString &name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(qint64 count) { bytes += count; }
+
+    private:
+        const char *name;
+        qint64 startNs;
+        qint64 bytes;
+        Scope *parent;
+    };
+
+    // Kruhový buffer pojme posledních Capacity úseků, starší se přepisují
+    static const int Capacity = 8192;
+
+    // Přičte alokaci k nejvnitřnějšímu otevřenému úseku tohoto vlákna
+    static void addBytes(qint64 count);
+    // Součet všech alokací od startu aplikace
+    static qint64 totalAllocatedBytes();
+
+    // Kopie úseků, které jsou v bufferu právě celé zapsané (od nejstaršího)
+    static QVector<Event> snapshot();
+    static QVector<StageSummary> summarize();
+    // Export ve formátu Chrome trace_event (chrome://tracing, Perfetto)
+    static bool exportChromeTrace(const QString &filePath);
+
+    static qint64 nowNs();
+    // Trvalý ukazatel na text názvu (názvy se nikdy neuvolňují)
+    static const char* intern(const QString &name);
+};
+
+#define BMP_TRACE_CONCAT_INNER(a, b) a##b
+#define BMP_TRACE_CONCAT(a, b) BMP_TRACE_CONCAT_INNER(a, b)
+#define BMP_TRACE_SCOPE(name) Trace::Scope BMP_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define BMP_TRACE_SCOPE_NAME(name) Trace::Scope BMP_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define BMP_TRACE_BYTES(count) Trace::addBytes(count)
+
+#else
+
+#define BMP_TRACE_SCOPE(name) do {} while (false)
+#define BMP_TRACE_SCOPE_NAME(name) do {} while (false)
+#define BMP_TRACE_BYTES(count) do {} while (false)
+
+#endif // BMPEDITOR_ENABLE_TRACING
+
+#endif // TRACE_H
@@ -0,0 +1,147 @@
+#include "UndoHistory.h"
+#include "Image.h"
+#include "ParallelRows.h"
+#include "Trace.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+const qint64 DefaultBudget = 256LL * 1024 * 1024;
+
+std::atomic<qint64> configuredBudget(-1);
+
+// Rychlá komprese - snímek se pořizuje před každou úpravou bez přesné inverze
+const int CompressionLevel = 1;
+
+} // namespace
+
+UndoHistory::Pixels UndoHistory::Pixels::compress(const QImage &image) {
+    Pixels pixels;
+    if (image.isNull()) {
+        return pixels;
+    }
+    BMP_TRACE_SCOPE("compress snapshot");
+    pixels.size = image.size();
+    pixels.format = image.format();
+    pixels.colorTable = image.colorTable();
+
+    const qint64 bytesPerLine = image.bytesPerLine();
+    const uchar *bits = image.constBits();
+    QMutex bandsMutex;
+    ParallelRows::forEachBand(image.height(), bytesPerLine, [&](int firstRow, int endRow) {
+        const QByteArray band = qCompress(bits + firstRow * bytesPerLine,
+                                          static_cast<int>((endRow - firstRow) * bytesPerLine), CompressionLevel);
+        QMutexLocker locker(&bandsMutex);
+        pixels.bands.insert(firstRow, band);
+    });
+    BMP_TRACE_BYTES(pixels.bytes());
+    return pixels;
+}
+
+QImage UndoHistory::Pixels::decompress() const {
+    if (format == QImage::Format_Invalid) {
+        return QImage();
+    }
+    BMP_TRACE_SCOPE("decompress snapshot");
+    QImage image(size, format);
+    if (image.isNull()) {
+        return image;
+    }
+    image.setColorTable(colorTable);
+
+    // Rozdělení na pásy se mohlo od komprese změnit - každý uložený pás
+    // rozbalí vlákno, do jehož rozsahu patří jeho první řádek
+    const qint64 bytesPerLine = image.bytesPerLine();
+    uchar *bits = image.bits();
+    ParallelRows::forEachBand(image.height(), bytesPerLine, [&](int firstRow, int endRow) {
+        for (auto band = bands.lowerBound(firstRow); band != bands.end() && band.key() < endRow; ++band) {
+            const QByteArray rows = qUncompress(band.value());
+            std::memcpy(bits + band.key() * bytesPerLine, rows.constData(),
+                        static_cast<size_t>(qMin<qint64>(rows.size(), (image.height() - band.key()) * bytesPerLine)));
+        }
+    });
+    return image;
+}
+
+qint64 UndoHistory::Pixels::bytes() const {
+    qint64 total = 0;
+    for (const QByteArray &band : bands) {
+        total += band.size();
+    }
+    return total;
+}
+
+qint64 UndoHistory::Step::bytes() const {
+    // Stav bez pixelů drží nanejvýš řádky BMP (obrázek po dlaždicích)
+    return pixels.bytes() + (state ? state->memoryUsage().total() : 0);
+}
+
+UndoHistory::UndoHistory() : position(0), limit(defaultBudget()) {}
+
+void UndoHistory::setBudget(qint64 bytes) {
+    limit = qMax<qint64>(0, bytes);
+    trim();
+}
+
+void UndoHistory::setDefaultBudget(qint64 bytes) {
+    configuredBudget = bytes;
+}
+
+qint64 UndoHistory::defaultBudget() {
+    qint64 budget = configuredBudget;
+    if (budget >= 0) {
+        return budget;
+    }
+    bool ok = false;
+    int megabytes = qEnvironmentVariableIntValue("BMPEDITOR_UNDO_BUDGET_MB", &ok);
+    return ok && megabytes >= 0 ? megabytes * 1024LL * 1024 : DefaultBudget;
+}
+
+void UndoHistory::push(const Step &step) {
+    if (!isEnabled()) {
+        return;
+    }
+    steps.resize(position);
+    steps.append(step);
+    position++;
+    trim();
+}
+
+void UndoHistory::clear() {
+    steps.clear();
+    position = 0;
+}
+
+void UndoHistory::undone(const Step &opposite) {
+    steps[--position] = opposite;
+    trim();
+}
+
+void UndoHistory::redone(const Step &opposite) {
+    steps[position++] = opposite;
+    trim();
+}
+
+qint64 UndoHistory::bytesUsed() const {
+    qint64 total = 0;
+    for (const Step &step : steps) {
+        total += step.bytes();
+    }
+    return total;
+}
+
+void UndoHistory::trim() {
+    // Zahazují se nejstarší kroky, potom kroky pro znovu nejdál od současného stavu
+    while (!steps.isEmpty() && (steps.size() > MaxSteps || bytesUsed() > limit)) {
+        if (position > 0) {
+            steps.removeFirst();
+            position--;
+        } else {
+            steps.removeLast();
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMap>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+class Filter;
+class Image;
+
+// Historie úprav obrázku pro zpět/znovu. Filtr s přesnou inverzí (inverze,
+// otočení, převrácení) se uloží jen jako operace a vrátí se její inverzí -
+// bez kopie pixelů. Ostatní kroky drží komprimovaný snímek druhého stavu.
+// Snímky se musí vejít do limitu paměti, nejstarší kroky se zahazují.
+class UndoHistory {
+public:
+    // Pixely QImage komprimované po pásech řádků (pásy se komprimují i rozbalují paralelně)
+    struct Pixels {
+        QSize size;
+        QImage::Format format = QImage::Format_Invalid;
+        QVector<QRgb> colorTable;
+        QMap<int, QByteArray> bands;  // první řádek pásu -> qCompress
+
+        static Pixels compress(const QImage &image);
+        QImage decompress() const;
+        qint64 bytes() const;
+    };
+
+    // Krok převádí obrázek do "druhého" stavu: dokud nebyl vrácen, do stavu
+    // před úpravou, po vrácení do stavu po ní. Provedení kroku dá krok opačný.
+    struct Step {
+        QString name;
+        std::shared_ptr<const Filter> filter;  // Operace vedoucí do druhého stavu, nebo
+        std::shared_ptr<const Image> state;    // druhý stav bez pixelů a historie
+        Pixels pixels;                         // a jeho komprimované pixely
+        QRect region;                          // Úprava jen oblasti: filtr platí pro ni a pixely jsou jen její
+        bool modified = false;                 // Příznak změny ve druhém stavu
+
+        qint64 bytes() const;
+    };
+
+    // Kroky bez snímku paměť skoro nezabírají, jejich počet je přesto omezený
+    static const int MaxSteps = 1000;
+
+    UndoHistory();
+
+    // Limit paměti snímků (0 = historie se nevede)
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return limit; }
+    bool isEnabled() const { return limit > 0; }
+
+    // Výchozí limit nových historií (záporná hodnota = proměnná prostředí
+    // BMPEDITOR_UNDO_BUDGET_MB, jinak 256 MB)
+    static void setDefaultBudget(qint64 bytes);
+    static qint64 defaultBudget();
+
+    // Nový krok zahodí kroky pro znovu
+    void push(const Step &step);
+    void clear();
+
+    bool canUndo() const { return position > 0; }
+    bool canRedo() const { return position < steps.size(); }
+    const Step &undoStep() const { return steps[position - 1]; }
+    const Step &redoStep() const { return steps[position]; }
+    // Po provedení kroku se na jeho místo uloží krok opačný
+    void undone(const Step &opposite);
+    void redone(const Step &opposite);
+
+    qint64 bytesUsed() const;
+
+private:
+    QVector<Step> steps;  // [0, position) lze vrátit, [position, size) provést znovu
+    int position;
+    qint64 limit;
+
+    void trim();
+};
+
+#endif // UNDOHISTORY_H
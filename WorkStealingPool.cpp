@@ -0,0 +1,140 @@
+#include "WorkStealingPool.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+// Pool a index fronty vlákna, ve kterém kód právě běží (nullptr mimo pool)
+thread_local const WorkStealingPool *currentPool = nullptr;
+thread_local int currentQueue = -1;
+
+} // namespace
+
+class WorkStealingPool::Worker : public QThread {
+public:
+    Worker(WorkStealingPool *pool, int index) : pool(pool), index(index) {}
+
+protected:
+    void run() override {
+        currentPool = pool;
+        currentQueue = index;
+        pool->runWorker(index);
+    }
+
+private:
+    WorkStealingPool *pool;
+    int index;
+};
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : queuedTasks(0), unfinishedTasks(0), nextQueue(0), steals(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+    threadCount = qMax(1, threadCount);
+
+    for (int i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>(this, i));
+        workers.back()->start();
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    waitForDone();
+    {
+        QMutexLocker locker(&stateMutex);
+        stopping = true;
+        workAvailable.wakeAll();
+    }
+    for (auto &worker : workers) {
+        worker->wait();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    // Z vlákna poolu do vlastní fronty, zvenku postupně do všech front
+    int index = (currentPool == this) ? currentQueue
+                                      : static_cast<int>(nextQueue++ % queues.size());
+    unfinishedTasks++;
+    queuedTasks++;
+    {
+        QMutexLocker locker(&queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // Počítadlo se zvýší dřív, než se vlákno vzbudí, proto se probuzení neztratí
+    QMutexLocker locker(&stateMutex);
+    workAvailable.wakeOne();
+}
+
+void WorkStealingPool::waitForDone() {
+    QMutexLocker locker(&stateMutex);
+    while (unfinishedTasks > 0) {
+        allDone.wait(&stateMutex);
+    }
+}
+
+int WorkStealingPool::threadCount() const {
+    return static_cast<int>(workers.size());
+}
+
+qint64 WorkStealingPool::stolenTasks() const {
+    return steals;
+}
+
+bool WorkStealingPool::takeTask(int index, Task &task) {
+    // Vlastní fronta od konce (naposledy zadaná úloha)
+    {
+        Queue &own = *queues[index];
+        QMutexLocker locker(&own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    // Cizí fronty od začátku (nejstarší úloha), počínaje sousedem
+    const int count = static_cast<int>(queues.size());
+    for (int offset = 1; offset < count; offset++) {
+        Queue &victim = *queues[(index + offset) % count];
+        QMutexLocker locker(&victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks--;
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::runWorker(int index) {
+    Task task;
+    for (;;) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+
+            if (--unfinishedTasks == 0) {
+                QMutexLocker locker(&stateMutex);
+                allDone.wakeAll();
+            }
+            continue;
+        }
+
+        QMutexLocker locker(&stateMutex);
+        while (queuedTasks == 0 && !stopping) {
+            workAvailable.wait(&stateMutex);
+        }
+        if (stopping && queuedTasks == 0) {
+            return;
+        }
+    }
+}
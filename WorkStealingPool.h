@@ -0,0 +1,61 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Pool vláken s vlastní frontou pro každé vlákno. Úloha zadaná z vlákna poolu
+// jde do jeho fronty (zpracuje se nejdřív - data jsou ještě v cache), úlohy
+// zvenku se rozdělují postupně mezi fronty. Vlákno bez práce si vezme
+// nejstarší úlohu z fronty jiného vlákna, takže nerovnoměrně velké úlohy
+// (např. různě velké soubory) nezdrží ostatní vlákna.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 = počet jader procesoru
+    explicit WorkStealingPool(int threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task);
+    // Čeká, dokud nejsou hotové všechny zadané úlohy (včetně těch, které
+    // během čekání zadaly jiné úlohy)
+    void waitForDone();
+
+    int threadCount() const;
+    // Počet úloh, které zpracovalo jiné vlákno, než do jehož fronty patřily
+    qint64 stolenTasks() const;
+
+private:
+    class Worker;
+
+    struct Queue {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    QMutex stateMutex;
+    QWaitCondition workAvailable;
+    QWaitCondition allDone;
+    std::atomic<int> queuedTasks;      // Úlohy ve frontách
+    std::atomic<int> unfinishedTasks;  // Úlohy zadané a ještě nedokončené
+    std::atomic<unsigned> nextQueue;
+    std::atomic<qint64> steals;
+    bool stopping;
+
+    bool takeTask(int index, Task &task);
+    void runWorker(int index);
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -0,0 +1,500 @@
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "Image.h"
+#include "RleCodec.h"
+#include "ThumbnailCache.h"
+#include "customimagewidget.h"
+#include "Filters/FilterPipeline.h"
+#include "Filters/FlipFilter.h"
+#include "Filters/InvertFilter.h"
+#include "Filters/RotateFilter.h"
+
+// Benchmarky kodeku, filtrů a vykreslování nad syntetickými BMP obrázky.
+// Výsledky lze uložit jako JSON a porovnat s dřívějším během (baseline).
+
+namespace {
+
+struct Result {
+    QString name;
+    int bitsPerPixel;
+    int width;
+    int height;
+    int iterations;
+    double nsPerIteration;  // Medián jedné iterace
+    double nsPerPixel;
+    double bytesPerSecond;
+};
+
+struct Settings {
+    qint64 minTimeNs = 200 * 1000 * 1000;
+    int minIterations = 3;
+    int maxIterations = 1000;
+    QString nameFilter;
+};
+
+QString resultKey(const QString &name, int bitsPerPixel, int width, int height) {
+    return QString("%1|%2|%3x%4").arg(name).arg(bitsPerPixel).arg(width).arg(height);
+}
+
+// Změří 'body' (setup před každou iterací se do času nepočítá); 'bytes' je
+// objem dat zpracovaný jednou iterací
+class Runner {
+public:
+    Runner(const Settings &settings, QTextStream &out) : settings(settings), out(out) {}
+
+    bool wants(const QString &name) const {
+        return settings.nameFilter.isEmpty() || name.contains(settings.nameFilter);
+    }
+
+    void measure(const QString &name, int bitsPerPixel, int width, int height, qint64 bytes,
+                 const std::function<void()> &body, const std::function<void()> &setup = nullptr) {
+        if (!wants(name)) {
+            return;
+        }
+
+        // Zahřívací běh (cache, alokace, líná inicializace Qt)
+        if (setup) setup();
+        body();
+
+        QVector<qint64> samples;
+        qint64 total = 0;
+        QElapsedTimer timer;
+        while (samples.size() < settings.maxIterations &&
+               (samples.size() < settings.minIterations || total < settings.minTimeNs)) {
+            if (setup) setup();
+            timer.start();
+            body();
+            qint64 elapsed = timer.nsecsElapsed();
+            samples.append(elapsed);
+            total += elapsed;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        Result result;
+        result.name = name;
+        result.bitsPerPixel = bitsPerPixel;
+        result.width = width;
+        result.height = height;
+        result.iterations = samples.size();
+        result.nsPerIteration = samples[samples.size() / 2];
+        result.nsPerPixel = result.nsPerIteration / (double(width) * height);
+        result.bytesPerSecond = bytes / qMax(1.0, result.nsPerIteration) * 1e9;
+        results.append(result);
+
+        out << QString("%1%2%3%4%5%6\n")
+                   .arg(name, -28)
+                   .arg(bitsPerPixel, 4)
+                   .arg(QString("%1x%2").arg(width).arg(height), 13)
+                   .arg(result.iterations, 7)
+                   .arg(result.nsPerPixel, 10, 'f', 3)
+                   .arg(result.bytesPerSecond / (1024.0 * 1024.0), 11, 'f', 1);
+        out.flush();
+    }
+
+    const QVector<Result>& all() const {
+        return results;
+    }
+
+private:
+    const Settings &settings;
+    QTextStream &out;
+    QVector<Result> results;
+};
+
+// Filtr bez cesty pro obrázky s paletou - po jeho použití se musí pixely
+// při uložení znovu zakódovat (měří se tak i kvantizace do palety)
+class TouchFilter : public Filter {
+public:
+    QImage apply(const QImage &image) const override { return image; }
+    QString name() const override { return "Touch"; }
+};
+
+// Syntetický BMP soubor: plynulé přechody s šumem, aby kodéry neměly
+// ani zcela jednolitá, ani zcela náhodná data. Bez šumu mají řádky dlouhé
+// běhy stejných pixelů (jako kresby nebo snímky obrazovky) - vhodné pro RLE.
+// 16 bitů se ukládá jako RGB565, 32 bitů jako BGRA s alfou (výstupy snímacích zařízení).
+QByteArray syntheticBmp(int width, int height, int bitsPerPixel, bool noisy = true) {
+    QVector<QRgb> palette;
+    if (bitsPerPixel <= 8) {
+        int colors = 1 << bitsPerPixel;
+        for (int i = 0; i < colors; i++) {
+            int value = i * 255 / (colors - 1);
+            palette.append(qRgb(value, 255 - value, (value * 7) & 0xff));
+        }
+    }
+
+    const qint64 bytesPerRow = Image::calculateRowSize(width, bitsPerPixel);
+    const qint64 pixelBytes = bytesPerRow * height;
+
+    Image::BMPInfoHeader infoHeader = {};
+    infoHeader.biWidth = width;
+    infoHeader.biHeight = height;
+    infoHeader.biPlanes = 1;
+    infoHeader.biBitCount = static_cast<uint16_t>(bitsPerPixel);
+    infoHeader.biSizeImage = static_cast<uint32_t>(pixelBytes);
+    infoHeader.biClrUsed = static_cast<uint32_t>(palette.size());
+    if (bitsPerPixel == 16 || bitsPerPixel == 32) {
+        infoHeader.biCompression = BitFields::Bitfields;
+        infoHeader.biRedMask = bitsPerPixel == 16 ? 0xf800 : 0x00ff0000;
+        infoHeader.biGreenMask = bitsPerPixel == 16 ? 0x07e0 : 0x0000ff00;
+        infoHeader.biBlueMask = bitsPerPixel == 16 ? 0x001f : 0x000000ff;
+        infoHeader.biAlphaMask = bitsPerPixel == 16 ? 0 : 0xff000000;
+    }
+    Image::prepareInfoHeader(infoHeader, 0);
+    const qint64 offset = Image::paletteOffset(infoHeader) + palette.size() * 4;
+
+    Image::BMPFileHeader fileHeader = {};
+    fileHeader.bfType[0] = 'B';
+    fileHeader.bfType[1] = 'M';
+    fileHeader.bfSize = static_cast<uint32_t>(offset + pixelBytes);
+    fileHeader.bfOffBits = static_cast<uint32_t>(offset);
+
+    QByteArray file;
+    file.reserve(static_cast<int>(offset + pixelBytes));
+    QBuffer buffer(&file);
+    buffer.open(QIODevice::WriteOnly);
+    Image::writeHeaders(buffer, fileHeader, infoHeader, palette);
+    buffer.close();
+
+    file.resize(static_cast<int>(offset + pixelBytes));
+    uchar *rows = reinterpret_cast<uchar*>(file.data()) + offset;
+    quint32 noise = 0x9e3779b9u;
+    for (int y = 0; y < height; y++) {
+        uchar *row = rows + y * bytesPerRow;
+        std::fill(row, row + bytesPerRow, 0);
+        for (int x = 0; x < width; x++) {
+            noise = noise * 1664525u + 1013904223u;
+            int jitter = noisy ? (noise >> 28) & 0x3 : 0;
+            int value = ((x + y) * 255 / qMax(1, width + height - 2) + jitter) & 0xff;
+            switch (bitsPerPixel) {
+                case 32:
+                    row[x * 4] = static_cast<uchar>(value);
+                    row[x * 4 + 1] = static_cast<uchar>((x * 255) / qMax(1, width - 1));
+                    row[x * 4 + 2] = static_cast<uchar>((y * 255) / qMax(1, height - 1));
+                    row[x * 4 + 3] = static_cast<uchar>(255 - value / 2);
+                    break;
+                case 16: {
+                    const int green = (x * 63) / qMax(1, width - 1);
+                    const int red = (y * 31) / qMax(1, height - 1);
+                    const quint16 pixel = static_cast<quint16>((red << 11) | (green << 5) | (value >> 3));
+                    row[x * 2] = static_cast<uchar>(pixel);
+                    row[x * 2 + 1] = static_cast<uchar>(pixel >> 8);
+                    break;
+                }
+                case 24:
+                    row[x * 3] = static_cast<uchar>(value);
+                    row[x * 3 + 1] = static_cast<uchar>((x * 255) / qMax(1, width - 1));
+                    row[x * 3 + 2] = static_cast<uchar>((y * 255) / qMax(1, height - 1));
+                    break;
+                case 8:
+                    row[x] = static_cast<uchar>(value);
+                    break;
+                case 4:
+                    row[x / 2] |= static_cast<uchar>((x % 2 == 0) ? (value >> 4) << 4 : value >> 4);
+                    break;
+                default:
+                    if (value & 0x80) row[x / 8] |= static_cast<uchar>(1 << (7 - (x % 8)));
+                    break;
+            }
+        }
+    }
+    return file;
+}
+
+QJsonDocument toJson(const QVector<Result> &results) {
+    QJsonArray array;
+    for (const Result &result : results) {
+        QJsonObject object;
+        object["name"] = result.name;
+        object["bitsPerPixel"] = result.bitsPerPixel;
+        object["width"] = result.width;
+        object["height"] = result.height;
+        object["iterations"] = result.iterations;
+        object["nsPerIteration"] = result.nsPerIteration;
+        object["nsPerPixel"] = result.nsPerPixel;
+        object["bytesPerSecond"] = result.bytesPerSecond;
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root["qtVersion"] = QString(qVersion());
+    root["results"] = array;
+    return QJsonDocument(root);
+}
+
+// Porovnání s uloženým během; vrací počet zpomalení nad toleranci
+int compareWithBaseline(const QVector<Result> &results, const QJsonDocument &baseline, double tolerance,
+                        QTextStream &out) {
+    QMap<QString, double> previous;
+    for (const QJsonValue &value : baseline.object()["results"].toArray()) {
+        QJsonObject object = value.toObject();
+        previous.insert(resultKey(object["name"].toString(), object["bitsPerPixel"].toInt(),
+                                  object["width"].toInt(), object["height"].toInt()),
+                        object["nsPerPixel"].toDouble());
+    }
+
+    int regressions = 0;
+    out << "\nPorovnání s baseline (ns/px):\n";
+    for (const Result &result : results) {
+        QString key = resultKey(result.name, result.bitsPerPixel, result.width, result.height);
+        if (!previous.contains(key) || previous[key] <= 0) {
+            continue;
+        }
+        double change = (result.nsPerPixel / previous[key] - 1.0) * 100.0;
+        bool regression = change > tolerance;
+        regressions += regression ? 1 : 0;
+        out << QString("%1%2%3%4%5%6%7\n")
+                   .arg(result.name, -28)
+                   .arg(result.bitsPerPixel, 4)
+                   .arg(QString("%1x%2").arg(result.width).arg(result.height), 13)
+                   .arg(previous[key], 10, 'f', 3)
+                   .arg(result.nsPerPixel, 10, 'f', 3)
+                   .arg(QString("%1%2 %").arg(change >= 0 ? "+" : "").arg(change, 0, 'f', 1), 10)
+                   .arg(regression ? "  ZPOMALENÍ" : "");
+    }
+    return regressions;
+}
+
+bool writeFile(const QString &path, const QByteArray &data) {
+    QFile output(path);
+    return output.open(QIODevice::WriteOnly) && output.write(data) == data.size();
+}
+
+// RLE proti nekomprimované cestě nad stejnými pixely; propustnost se u obou
+// počítá z nekomprimované velikosti, aby byla čísla přímo srovnatelná
+void benchmarkRle(Runner &runner, const QTemporaryDir &directory, int size, int bitsPerPixel) {
+    Image image;
+    if (!image.loadFromData(syntheticBmp(size, size, bitsPerPixel, false))) {
+        return;
+    }
+
+    QByteArray uncompressed;
+    if (!image.saveToData(uncompressed)) {
+        return;
+    }
+    const qint64 bytes = uncompressed.size();
+    runner.measure("encode smooth", bitsPerPixel, size, size, bytes, [&]() {
+        image.saveToData(uncompressed);
+    });
+    image.setSaveCompression(Image::Compression::RleIfSmaller);
+    QByteArray compressed;
+    runner.measure("encode smooth rle", bitsPerPixel, size, size, bytes, [&]() {
+        image.saveToData(compressed);
+    });
+
+    const QString plainPath = directory.filePath(QString("smooth_%1_%2.bmp").arg(size).arg(bitsPerPixel));
+    const QString rlePath = directory.filePath(QString("smooth_rle_%1_%2.bmp").arg(size).arg(bitsPerPixel));
+    if (!writeFile(plainPath, uncompressed) || !writeFile(rlePath, compressed)) {
+        return;
+    }
+    runner.measure("decode smooth", bitsPerPixel, size, size, bytes, [&]() {
+        Image decoded;
+        decoded.loadFromFile(plainPath, Image::LoadMode::Mapped);
+    });
+    runner.measure("decode smooth rle", bitsPerPixel, size, size, bytes, [&]() {
+        Image decoded;
+        decoded.loadFromFile(rlePath, Image::LoadMode::Mapped);
+    });
+}
+
+void benchmarkCodec(Runner &runner, const QTemporaryDir &directory, int size, int bitsPerPixel) {
+    const QByteArray file = syntheticBmp(size, size, bitsPerPixel);
+    const QString path = directory.filePath(QString("bench_%1_%2.bmp").arg(size).arg(bitsPerPixel));
+    if (!writeFile(path, file)) {
+        return;
+    }
+
+    // Dekódování - stejná cesta jako při otevření souboru v editoru (mapování)
+    runner.measure("decode", bitsPerPixel, size, size, file.size(), [&]() {
+        Image image;
+        image.loadFromFile(path, Image::LoadMode::Mapped);
+    });
+    // Jen hlavičky a paleta - doba nezávisí na velikosti obrázku
+    runner.measure("probe", bitsPerPixel, size, size, file.size(), [&]() {
+        Image::probe(path);
+    });
+    // Zmenšenina pro procházení složky (bez cache) - čtou se jen vzorkované řádky
+    runner.measure("thumbnail", bitsPerPixel, size, size, file.size(), [&]() {
+        ThumbnailCache::decode(path, ThumbnailCache::DefaultSize);
+    });
+
+    Image image;
+    if (!image.loadFromFile(path, Image::LoadMode::Buffered)) {
+        return;
+    }
+
+    // Uložení beze změny (zapisují se raw data) a po změně pixelů (kódování)
+    QByteArray encoded;
+    runner.measure("encode unmodified", bitsPerPixel, size, size, file.size(), [&]() {
+        image.saveToData(encoded);
+    });
+
+    Image modified = image;
+    modified.applyFilter(TouchFilter());
+    runner.measure("encode modified", bitsPerPixel, size, size, file.size(), [&]() {
+        modified.saveToData(encoded);
+    });
+
+    // Po úpravě jen horních řádků se ostatní řádky kopírují z raw dat
+    Image regionModified = image;
+    regionModified.applyFilter(TouchFilter(), QRect(0, 0, size, qMax(1, size / 16)));
+    runner.measure("encode region", bitsPerPixel, size, size, file.size(), [&]() {
+        regionModified.saveToData(encoded);
+    });
+
+    // Filtr nad Image - obrázky s paletou mají vlastní cestu
+    InvertFilter invert;
+    RotateFilter rotate(90);
+    Image target;
+    runner.measure("image invert", bitsPerPixel, size, size, file.size(),
+                   [&]() { target.applyFilter(invert); }, [&]() { target = image; });
+    runner.measure("image rotate90", bitsPerPixel, size, size, file.size(),
+                   [&]() { target.applyFilter(rotate); }, [&]() { target = image; });
+
+    if (RleCodec::compressionFor(bitsPerPixel) != 0) {
+        benchmarkRle(runner, directory, size, bitsPerPixel);
+    }
+}
+
+void benchmarkFilters(Runner &runner, const QImage &image) {
+    const int width = image.width();
+    const int height = image.height();
+    const qint64 bytes = qint64(image.bytesPerLine()) * height;
+
+    std::vector<std::pair<QString, std::shared_ptr<const Filter>>> filters;
+    filters.emplace_back("filter invert", std::make_shared<InvertFilter>());
+    filters.emplace_back("filter rotate90", std::make_shared<RotateFilter>(90));
+    filters.emplace_back("filter rotate180", std::make_shared<RotateFilter>(180));
+    filters.emplace_back("filter rotate270", std::make_shared<RotateFilter>(270));
+    filters.emplace_back("filter flip", std::make_shared<FlipFilter>());
+
+    auto pipeline = std::make_shared<FilterPipeline>();
+    pipeline->append(std::make_shared<InvertFilter>());
+    pipeline->append(std::make_shared<RotateFilter>(90));
+    pipeline->append(std::make_shared<FlipFilter>());
+    filters.emplace_back("pipeline invert>rot90>flip", pipeline);
+
+    for (const auto &filter : filters) {
+        QImage result;
+        runner.measure(filter.first, 32, width, height, bytes, [&]() { result = filter.second->apply(image); });
+    }
+}
+
+void benchmarkRendering(Runner &runner, const QImage &image) {
+    const QSize viewSize(1280, 800);
+    CustomImageWidget widget;
+    widget.resize(viewSize);
+    QImage target(viewSize, QImage::Format_RGB32);
+
+    const double zooms[] = {0.25, 0.5, 1.0, 2.0, 4.0};
+    for (double zoom : zooms) {
+        const QString name = QString("render zoom %1").arg(zoom);
+        if (!runner.wants(name)) {
+            continue;
+        }
+        widget.setZoomFactor(zoom);
+        // Nový obrázek před každou iterací - měří se vykreslení bez cache výřezu
+        runner.measure(name, 32, image.width(), image.height(), qint64(viewSize.width()) * viewSize.height() * 4,
+                       [&]() { widget.render(&target); }, [&]() { widget.setImage(image); });
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    // Widget se vykresluje do QImage, okno ani displej nejsou potřeba
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("bmp_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarky dekódování, kódování, filtrů a vykreslování BMP");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Velikosti čtvercových obrázků", "seznam", "256,1024,4096,16384");
+    QCommandLineOption depthsOption("depths", "Bitové hloubky", "seznam", "1,4,8,16,24,32");
+    QCommandLineOption filterOption("filter", "Jen benchmarky, jejichž název obsahuje text", "text");
+    QCommandLineOption minTimeOption("min-time", "Nejkratší doba měření jednoho benchmarku v ms", "ms", "200");
+    QCommandLineOption jsonOption("json", "Uložit výsledky jako JSON", "soubor");
+    QCommandLineOption baselineOption("baseline", "Porovnat s dřívějšími výsledky (JSON)", "soubor");
+    QCommandLineOption toleranceOption("tolerance", "Povolené zpomalení proti baseline v %", "procenta", "10");
+    parser.addOptions({sizesOption, depthsOption, filterOption, minTimeOption, jsonOption, baselineOption,
+                       toleranceOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Settings settings;
+    settings.minTimeNs = parser.value(minTimeOption).toLongLong() * 1000 * 1000;
+    settings.nameFilter = parser.value(filterOption);
+
+    QVector<int> sizes;
+    for (const QString &value : parser.value(sizesOption).split(',')) {
+        if (value.toInt() > 0) sizes.append(value.toInt());
+    }
+    QVector<int> depths;
+    for (const QString &value : parser.value(depthsOption).split(',')) {
+        int depth = value.toInt();
+        if (depth == 1 || depth == 4 || depth == 8 || depth == 16 || depth == 24 || depth == 32) depths.append(depth);
+    }
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err << "Nelze vytvořit dočasný adresář\n";
+        return 2;
+    }
+
+    out << QString("%1%2%3%4%5%6\n").arg("benchmark", -28).arg("bpp", 4).arg("rozměr", 13)
+                                     .arg("iterace", 7).arg("ns/px", 10).arg("MB/s", 11);
+
+    Runner runner(settings, out);
+    for (int size : sizes) {
+        for (int depth : depths) {
+            benchmarkCodec(runner, directory, size, depth);
+        }
+
+        // Filtry a vykreslování pracují s 32bitovým obrázkem bez ohledu na zdroj
+        Image image;
+        if (image.loadFromData(syntheticBmp(size, size, 24))) {
+            const QImage decoded = image.toQImage();
+            benchmarkFilters(runner, decoded);
+            benchmarkRendering(runner, decoded);
+        }
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(toJson(runner.all()).toJson()) < 0) {
+            err << QString("Nelze zapsat %1\n").arg(parser.value(jsonOption));
+            return 2;
+        }
+    }
+
+    if (parser.isSet(baselineOption)) {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << QString("Nelze načíst %1\n").arg(parser.value(baselineOption));
+            return 2;
+        }
+        int regressions = compareWithBaseline(runner.all(), QJsonDocument::fromJson(file.readAll()),
+                                              parser.value(toleranceOption).toDouble(), out);
+        out.flush();
+        return regressions == 0 ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+#include <memory>
+
+#include "BatchProcessor.h"
+#include "BmpStreamProcessor.h"
+#include "MetadataIndex.h"
+#include "Filters/FilterPipeline.h"
+#include "Filters/FlipFilter.h"
+#include "Filters/InvertFilter.h"
+#include "Filters/RotateFilter.h"
+
+namespace {
+
+// Řetězec filtrů ve tvaru "invert,rotate:90,flip" (rotate bez úhlu = 90°)
+bool parseFilterChain(const QString &chain, FilterPipeline &pipeline, QString &error) {
+    const QStringList tokens = chain.split(',');
+    for (QString token : tokens) {
+        token = token.trimmed().toLower();
+        if (token.isEmpty()) {
+            continue;
+        }
+        QString name = token.section(':', 0, 0);
+        QString argument = token.section(':', 1);
+
+        if (name == "invert" && argument.isEmpty()) {
+            pipeline.append(std::make_shared<InvertFilter>());
+        } else if (name == "flip" && argument.isEmpty()) {
+            pipeline.append(std::make_shared<FlipFilter>());
+        } else if (name == "rotate") {
+            bool ok = true;
+            int angle = argument.isEmpty() ? 90 : argument.toInt(&ok);
+            if (!ok || angle % 90 != 0) {
+                error = QString("Neplatný úhel rotace '%1' (musí být násobek 90)").arg(argument);
+                return false;
+            }
+            pipeline.append(std::make_shared<RotateFilter>(angle));
+        } else {
+            error = QString("Neznámý filtr '%1'").arg(token);
+            return false;
+        }
+    }
+    return true;
+}
+
+double milliseconds(qint64 ns) {
+    return ns / 1e6;
+}
+
+void printStats(QTextStream &out, const BatchProcessor::Stats &stats) {
+    const double seconds = qMax(1e-9, stats.elapsedNs / 1e9);
+    const double megabyte = 1024.0 * 1024.0;
+
+    out << QString("Zpracováno %1 souborů (%2 chyb) za %3 s\n")
+               .arg(stats.processedFiles).arg(stats.failedFiles).arg(seconds, 0, 'f', 2);
+    out << QString("Propustnost: %1 souborů/s, čtení %2 MB/s, zápis %3 MB/s\n")
+               .arg(stats.processedFiles / seconds, 0, 'f', 1)
+               .arg(stats.bytesRead / megabyte / seconds, 0, 'f', 1)
+               .arg(stats.bytesWritten / megabyte / seconds, 0, 'f', 1);
+    out << QString("Úlohy převzaté jiným vláknem: %1\n").arg(stats.stolenTasks);
+
+    // Latence jednotlivých fází na soubor
+    out << QString("%1%2%3%4%5\n").arg("fáze", -12).arg("p50 ms", 10).arg("p90 ms", 10)
+                                   .arg("p99 ms", 10).arg("max ms", 10);
+    for (int stage = 0; stage < BatchProcessor::StageCount; stage++) {
+        const QVector<qint64> &samples = stats.stageNs[stage];
+        out << QString("%1%2%3%4%5\n")
+                   .arg(BatchProcessor::stageName(static_cast<BatchProcessor::Stage>(stage)), -12)
+                   .arg(milliseconds(BatchProcessor::percentile(samples, 0.50)), 10, 'f', 2)
+                   .arg(milliseconds(BatchProcessor::percentile(samples, 0.90)), 10, 'f', 2)
+                   .arg(milliseconds(BatchProcessor::percentile(samples, 0.99)), 10, 'f', 2)
+                   .arg(milliseconds(BatchProcessor::percentile(samples, 1.0)), 10, 'f', 2);
+    }
+}
+
+// Režim --index: jen metadata z hlaviček, bez dekódování a zápisu obrázků
+int runIndex(QTextStream &out, QTextStream &err, const QString &indexPath, const QStringList &files,
+             int threads, bool list) {
+    MetadataIndex index;
+    index.load(indexPath);  // Chybějící index se vytvoří znovu
+    const MetadataIndex::UpdateStats stats = index.update(files, threads);
+    const int removed = index.removeMissing();
+    if (!index.save(indexPath)) {
+        err << QString("Nelze zapsat index %1\n").arg(indexPath);
+        return 1;
+    }
+
+    if (list) {
+        for (const QString &path : files) {
+            if (!index.contains(path)) {
+                continue;  // Soubor mezitím zmizel
+            }
+            const MetadataIndex::Entry entry = index.entry(path);
+            if (!entry.valid) {
+                out << QString("%1\tneplatný BMP\n").arg(path);
+                continue;
+            }
+            out << QString("%1\t%2x%3\t%4 bpp\t%5 barev%6\n")
+                       .arg(path).arg(entry.width).arg(entry.height).arg(entry.bitsPerPixel)
+                       .arg(entry.paletteSize).arg(entry.supported ? "" : "\tnepodporovaný");
+        }
+    }
+
+    out << QString("Index: %1 souborů, přečteno %2, beze změny %3, odstraněno %4 za %5 s\n")
+               .arg(index.size()).arg(stats.probed).arg(stats.reused).arg(stats.missing + removed)
+               .arg(stats.elapsedNs / 1e9, 0, 'f', 2);
+    return 0;
+}
+
+// Režim --stream: soubory se zpracují jeden po druhém po blocích řádků, paměť
+// nezávisí na velikosti obrázku (jen řádkové filtry, výstup bez komprese)
+int runStream(QTextStream &out, QTextStream &err, const QVector<BatchProcessor::Item> &items,
+              const FilterPipeline &pipeline) {
+    QVector<const Filter*> filters;
+    if (!pipeline.isEmpty()) {
+        filters.append(&pipeline);
+    }
+
+    BmpStreamProcessor processor;
+    QElapsedTimer timer;
+    timer.start();
+    int processed = 0;
+    int failed = 0;
+    qint64 bytesRead = 0;
+    qint64 bytesWritten = 0;
+    for (const BatchProcessor::Item &item : items) {
+        QDir().mkpath(QFileInfo(item.outputPath).absolutePath());
+        if (!processor.process(item.inputPath, item.outputPath, filters)) {
+            err << QString("%1: %2\n").arg(item.inputPath, processor.errorString());
+            failed++;
+            continue;
+        }
+        processed++;
+        bytesRead += QFileInfo(item.inputPath).size();
+        bytesWritten += QFileInfo(item.outputPath).size();
+    }
+    err.flush();
+
+    const double seconds = qMax(1e-9, timer.nsecsElapsed() / 1e9);
+    const double megabyte = 1024.0 * 1024.0;
+    out << QString("Zpracováno proudově %1 souborů (%2 chyb) za %3 s\n")
+               .arg(processed).arg(failed).arg(seconds, 0, 'f', 2);
+    out << QString("Propustnost: čtení %1 MB/s, zápis %2 MB/s\n")
+               .arg(bytesRead / megabyte / seconds, 0, 'f', 1)
+               .arg(bytesWritten / megabyte / seconds, 0, 'f', 1);
+    return failed == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bmpbatch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Dávkové zpracování BMP souborů řetězcem filtrů");
+    parser.addHelpOption();
+    parser.addPositionalArgument("vstup", "Adresář s BMP soubory nebo maska souborů (např. \"in/*.bmp\")");
+
+    QCommandLineOption outputOption({"o", "output"}, "Výstupní adresář", "adresář");
+    QCommandLineOption filtersOption({"f", "filters"}, "Řetězec filtrů, např. invert,rotate:90,flip", "filtry");
+    QCommandLineOption recursiveOption({"r", "recursive"}, "Procházet i podadresáře");
+    QCommandLineOption threadsOption({"j", "threads"}, "Počet výpočetních vláken (0 = počet jader)", "počet", "0");
+    QCommandLineOption ioThreadsOption("io-threads", "Počet vláken pro čtení a zápis", "počet", "2");
+    QCommandLineOption inFlightOption("in-flight", "Nejvyšší počet rozpracovaných souborů (0 = automaticky)",
+                                      "počet", "0");
+    QCommandLineOption rleOption("rle", "Ukládat 4 a 8bitové obrázky s kompresí RLE, pokud vyjde menší");
+    QCommandLineOption indexOption("index", "Jen zjistit metadata souborů (z hlaviček) a uložit je do indexu; "
+                                            "nezměněné soubory se při dalším běhu nečtou", "soubor");
+    QCommandLineOption listOption("list", "S --index vypsat rozměry, bitovou hloubku a velikost palety souborů");
+    QCommandLineOption streamOption("stream", "Zpracovávat soubory proudově po blocích řádků - paměť nezávisí na "
+                                              "velikosti obrázku (jen řádkové filtry invert a flip, bez RLE)");
+    parser.addOptions({outputOption, filtersOption, recursiveOption, threadsOption, ioThreadsOption, inFlightOption,
+                       rleOption, indexOption, listOption, streamOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1 || (!parser.isSet(outputOption) && !parser.isSet(indexOption))) {
+        err << parser.helpText();
+        return 2;
+    }
+
+    if (parser.isSet(indexOption)) {
+        const QStringList files = BatchProcessor::collectFiles(parser.positionalArguments().first(),
+                                                               parser.isSet(recursiveOption));
+        return runIndex(out, err, parser.value(indexOption), files, parser.value(threadsOption).toInt(),
+                        parser.isSet(listOption));
+    }
+
+    FilterPipeline pipeline;
+    QString error;
+    if (!parseFilterChain(parser.value(filtersOption), pipeline, error)) {
+        err << error << "\n";
+        return 2;
+    }
+
+    const QVector<BatchProcessor::Item> items =
+        BatchProcessor::collectItems(parser.positionalArguments().first(), parser.value(outputOption),
+                                     parser.isSet(recursiveOption));
+    if (items.isEmpty()) {
+        err << "Nebyly nalezeny žádné soubory\n";
+        return 2;
+    }
+
+    if (parser.isSet(streamOption)) {
+        if (!pipeline.isRowLocal()) {
+            err << QString("Filtry '%1' nelze použít při proudovém zpracování (jen invert a flip)\n")
+                       .arg(parser.value(filtersOption));
+            return 2;
+        }
+        if (parser.isSet(rleOption)) {
+            err << "Proudové zpracování neumí ukládat s kompresí RLE\n";
+            return 2;
+        }
+        if (!pipeline.isEmpty()) {
+            out << QString("Filtry: %1 (proudově)\n").arg(pipeline.name());
+        }
+        out.flush();
+        return runStream(out, err, items, pipeline);
+    }
+
+    BatchProcessor::Options options;
+    options.computeThreads = parser.value(threadsOption).toInt();
+    options.ioThreads = parser.value(ioThreadsOption).toInt();
+    options.maxFilesInFlight = parser.value(inFlightOption).toInt();
+    options.rleCompression = parser.isSet(rleOption);
+
+    if (!pipeline.isEmpty()) {
+        out << QString("Filtry: %1 (%2 průchodů)\n").arg(pipeline.name()).arg(pipeline.passCount());
+    }
+    out.flush();
+
+    BatchProcessor processor(pipeline, options);
+    const BatchProcessor::Stats stats = processor.run(items);
+
+    for (const QString &message : stats.errors) {
+        err << message << "\n";
+    }
+    err.flush();
+    printStats(out, stats);
+    return stats.failedFiles == 0 ? 0 : 1;
+}
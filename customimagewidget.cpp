@@ -1,17 +1,59 @@
 #include "customimagewidget.h"
+#include "MipPyramid.h"
+#include "TiledImageStore.h"
+#include "Trace.h"
 
 #include <iostream>
 #include <QPainter>
 #include <QScrollBar>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
 
 CustomImageWidget::CustomImageWidget(QWidget* parent)
-    : QWidget(parent), zoomFactor(1.0) {}
+    : QWidget(parent), zoomFactor(1.0), refreshScheduled(false), loadedRows(-1), sourceLostReported(false),
+      cachedZoom(0.0), cachedSourceKey(0) {}
 
-void CustomImageWidget::setImage(const QImage& newImage) {
-    image = newImage;
+namespace {
+
+const QRgb PendingRowColor = 0xffd0d0d0;
+
+} // namespace
+
+void CustomImageWidget::setImage(const QImage& newImage, std::shared_ptr<const MipPyramid> newPyramid) {
+    pyramid = std::move(newPyramid);
+    tiles.reset();
+    loadedRows = -1;
+    // Vykreslování čte přímo 32bitové řádky nebo indexy s tabulkou barev
+    // (obrázky s paletou z Image), jiné formáty se převedou
+    const QImage::Format format = newImage.format();
+    image = (format == QImage::Format_RGB32 || format == QImage::Format_ARGB32 ||
+             format == QImage::Format_Indexed8 || format == QImage::Format_Mono)
+            ? newImage : newImage.convertToFormat(QImage::Format_ARGB32);
+    viewportCache = QImage();
     update(); // Vyvolá překreslení
 }
 
+void CustomImageWidget::setPartialImage(const QImage& partialImage, int readyRows) {
+    // Dekodér zapisuje do stejného obrázku dál - čtou se jen hotové řádky
+    image = partialImage;
+    loadedRows = qBound(0, readyRows, partialImage.height());
+    pyramid.reset();
+    tiles.reset();
+    viewportCache = QImage();
+    update();
+}
+
+void CustomImageWidget::setTiledImage(std::shared_ptr<const TiledImageStore> store) {
+    tiles = std::move(store);
+    sourceLostReported = false;
+    loadedRows = -1;
+    image = QImage();
+    pyramid.reset();
+    viewportCache = QImage();
+    update();
+}
+
 void CustomImageWidget::setZoomFactor(double factor) {
     // Omezení faktoru zoomu na rozumné hodnoty
     zoomFactor = qBound(0.1, factor, 10.0);
@@ -35,42 +77,176 @@ void CustomImageWidget::resetZoom() {
 }
 
 void CustomImageWidget::paintEvent(QPaintEvent* event) {
-    if (image.isNull()) return;
+    Q_UNUSED(event);
+    if (image.isNull() && !tiles) return;
+    BMP_TRACE_SCOPE("paint");
 
     QPainter painter(this);
 
-    int scaledWidth = qRound(image.width() * zoomFactor);
-    int scaledHeight = qRound(image.height() * zoomFactor);
-
-    // Vytvoření nového obrázku se zvětšenými pixely
-    QImage scaledImage(scaledWidth, scaledHeight, QImage::Format_RGB32);
-
-    // Vyplnění obrázku zvětšenými pixely
-    for (int y = 0; y < image.height(); y++) {
-        int scaledY = qRound(y * zoomFactor);
-        int pixelHeight = qRound((y + 1) * zoomFactor) - scaledY;
-
-        for (int x = 0; x < image.width(); x++) {
-            QRgb pixel = image.pixel(x, y);
-            int scaledX = qRound(x * zoomFactor);
-            int pixelWidth = qRound((x + 1) * zoomFactor) - scaledX;
-
-            // Vyplnění bloku pixelů stejnou barvou
-            for (int sy = 0; sy < pixelHeight; sy++) {
-                for (int sx = 0; sx < pixelWidth; sx++) {
-                    if (scaledX + sx < scaledWidth && scaledY + sy < scaledHeight) {
-                        scaledImage.setPixel(scaledX + sx, scaledY + sy, pixel);
-                    }
-                }
+    const QSize imageSize = tiles ? tiles->size() : image.size();
+    int scaledWidth = qRound(imageSize.width() * zoomFactor);
+    int scaledHeight = qRound(imageSize.height() * zoomFactor);
+
+    // Zvětšený obrázek je vycentrovaný; vykresluje se jen jeho viditelná část
+    int x_offset = (width() - scaledWidth) / 2;
+    int y_offset = (height() - scaledHeight) / 2;
+    QRect viewport = QRect(-x_offset, -y_offset, width(), height())
+                     .intersected(QRect(0, 0, scaledWidth, scaledHeight));
+    if (viewport.isEmpty()) return;
+
+    if (tiles) {
+        if (viewportCache.isNull() || viewport != cachedViewport || zoomFactor != cachedZoom) {
+            renderTiledViewport(viewport);
+        }
+        painter.drawImage(x_offset + viewport.x(), y_offset + viewport.y(), viewportCache);
+        if (tiles->isSourceLost() && !sourceLostReported) {
+            sourceLostReported = true;
+            emit sourceLost();
+        }
+        return;
+    }
+
+    // Při oddálení se čte menší úroveň pyramidy (její pixel pokrývá 2^level pixelů)
+    QImage source = image;
+    int level = 0;
+    if (pyramid) {
+        QImage levelImage = pyramid->levelForZoom(zoomFactor, &level);
+        if (level > 0) {
+            source = levelImage;
+        }
+        if (!pyramid->isComplete() && !refreshScheduled) {
+            // Úrovně se ještě počítají - překreslí se, až budou k dispozici
+            refreshScheduled = true;
+            QTimer::singleShot(100, this, [this]() {
+                refreshScheduled = false;
+                update();
+            });
+        }
+    }
+
+    if (viewportCache.isNull() || viewport != cachedViewport || zoomFactor != cachedZoom
+        || source.cacheKey() != cachedSourceKey) {
+        renderViewport(viewport, source, zoomFactor * (1 << level));
+    }
+    painter.drawImage(x_offset + viewport.x(), y_offset + viewport.y(), viewportCache);
+
+    // Ukazatel průběhu načítání
+    if (loadedRows >= 0) {
+        const QString text = QString("Načteno %1 / %2 řádků").arg(loadedRows).arg(image.height());
+        const QRect textRect = painter.fontMetrics().boundingRect(text).adjusted(-6, -4, 6, 4);
+        const QRect box(8, 8, textRect.width(), textRect.height());
+        painter.fillRect(box, QColor(0, 0, 0, 160));
+        painter.setPen(Qt::white);
+        painter.drawText(box, Qt::AlignCenter, text);
+    }
+}
+
+QVector<int> CustomImageWidget::sourceIndices(int first, int count, int sourceSize, double zoom) {
+    // Zdrojový pixel i pokrývá zvětšené pixely [qRound(i * zoom), qRound((i + 1) * zoom));
+    // při zmenšení připadne zvětšený pixel poslednímu zdrojovému, který ho pokrývá
+    QVector<int> indices(count);
+    int source = qBound(0, static_cast<int>(first / zoom) - 1, sourceSize - 1);
+    while (source > 0 && qRound(source * zoom) > first) {
+        source--;
+    }
+    for (int i = 0; i < count; i++) {
+        int scaled = first + i;
+        while (source + 1 < sourceSize && qRound((source + 1) * zoom) <= scaled) {
+            source++;
+        }
+        indices[i] = source;
+    }
+    return indices;
+}
+
+void CustomImageWidget::renderViewport(const QRect& viewport, const QImage& source, double sourceZoom) {
+    const QVector<int> columns = sourceIndices(viewport.x(), viewport.width(), source.width(), sourceZoom);
+    const QVector<int> rows = sourceIndices(viewport.y(), viewport.height(), source.height(), sourceZoom);
+
+    // Při načítání se čtou jen hotové řádky základní úrovně
+    gather(source, QPoint(0, 0), columns, rows, loadedRows >= 0 ? loadedRows : INT_MAX);
+    cachedViewport = viewport;
+    cachedZoom = zoomFactor;
+    cachedSourceKey = source.cacheKey();
+}
+
+void CustomImageWidget::renderTiledViewport(const QRect& viewport) {
+    const QVector<int> columns = sourceIndices(viewport.x(), viewport.width(), tiles->width(), zoomFactor);
+    const QVector<int> rows = sourceIndices(viewport.y(), viewport.height(), tiles->height(), zoomFactor);
+
+    if (zoomFactor >= 1.0) {
+        // Dekódují se jen dlaždice pokrývající viditelnou oblast
+        const QRect needed(QPoint(columns.first(), rows.first()), QPoint(columns.last(), rows.last()));
+        gather(tiles->copy(needed), needed.topLeft(), columns, rows);
+    } else {
+        // Při oddálení se vzorkují jednotlivé pixely přímo z dat souboru
+        viewportCache = QImage(viewport.width(), viewport.height(), QImage::Format_RGB32);
+        BMP_TRACE_BYTES(qint64(viewportCache.bytesPerLine()) * viewportCache.height());
+        const size_t rowBytes = static_cast<size_t>(viewportCache.width()) * sizeof(QRgb);
+        for (int y = 0; y < viewport.height(); y++) {
+            QRgb *out = reinterpret_cast<QRgb*>(viewportCache.scanLine(y));
+            if (y > 0 && rows[y] == rows[y - 1]) {
+                memcpy(out, viewportCache.constScanLine(y - 1), rowBytes);
+                continue;
             }
+            tiles->sampleRow(rows[y], columns, out);
         }
     }
 
-    // Vykreslení připraveného obrázku
-    int x_offset = (width() - scaledWidth) / 2;
-    int y_offset = (height() - scaledHeight) / 2;
-    painter.drawImage(x_offset, y_offset, scaledImage);
+    cachedViewport = viewport;
+    cachedZoom = zoomFactor;
+    cachedSourceKey = 0;
+}
+
+void CustomImageWidget::gather(const QImage& source, QPoint origin, const QVector<int>& columns, const QVector<int>& rows,
+                               int availableRows) {
+    viewportCache = QImage(columns.size(), rows.size(), QImage::Format_RGB32);
+    BMP_TRACE_BYTES(qint64(viewportCache.bytesPerLine()) * viewportCache.height());
+    const int cacheWidth = viewportCache.width();
+    const size_t rowBytes = static_cast<size_t>(cacheWidth) * sizeof(QRgb);
+
+    // Indexy se převádějí přes tabulku barev (mimo tabulku černá)
+    const QImage::Format format = source.format();
+    QVector<QRgb> colors(256, qRgb(0, 0, 0));
+    const QVector<QRgb> table = source.colorTable();
+    for (int i = 0; i < table.size() && i < colors.size(); i++) {
+        colors[i] = table[i];
+    }
+
+    for (int y = 0; y < rows.size(); y++) {
+        QRgb *out = reinterpret_cast<QRgb*>(viewportCache.scanLine(y));
+
+        // Zvětšený zdrojový řádek se opakuje - stačí zkopírovat předchozí
+        if (y > 0 && rows[y] == rows[y - 1]) {
+            memcpy(out, viewportCache.constScanLine(y - 1), rowBytes);
+            continue;
+        }
+
+        // Řádek, který ještě není načtený
+        if (rows[y] >= availableRows) {
+            std::fill(out, out + cacheWidth, PendingRowColor);
+            continue;
+        }
+
+        const uchar *line = source.constScanLine(rows[y] - origin.y());
+        if (format == QImage::Format_Indexed8) {
+            for (int x = 0; x < cacheWidth; x++) {
+                out[x] = colors[line[columns[x] - origin.x()]] | 0xff000000;
+            }
+        } else if (format == QImage::Format_Mono) {
+            for (int x = 0; x < cacheWidth; x++) {
+                const int column = columns[x] - origin.x();
+                out[x] = colors[(line[column >> 3] >> (7 - (column & 7))) & 1] | 0xff000000;
+            }
+        } else {
+            const QRgb *in = reinterpret_cast<const QRgb*>(line);
+            for (int x = 0; x < cacheWidth; x++) {
+                out[x] = in[columns[x] - origin.x()] | 0xff000000;  // Alfa se nezobrazuje
+            }
+        }
+    }
 }
+
 void CustomImageWidget::wheelEvent(QWheelEvent* event) {
     if (event->angleDelta().y() > 0) {
         zoomIn();
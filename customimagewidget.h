@@ -3,15 +3,27 @@
 #define CUSTOMIMAGEWIDGET_H
 
 #include <QImage>
+#include <QRect>
+#include <QVector>
 #include <QPaintEvent>
 #include <QWidget>
 #include <QWheelEvent>
+#include <climits>
+#include <memory>
+
+class MipPyramid;
+class TiledImageStore;
 
 class CustomImageWidget : public QWidget {
     Q_OBJECT
 public:
     CustomImageWidget(QWidget* parent = nullptr);
-    void setImage(const QImage& newImage);
+    // Při oddálení se místo obrázku vykresluje vhodná úroveň pyramidy (pokud je)
+    void setImage(const QImage& newImage, std::shared_ptr<const MipPyramid> newPyramid = nullptr);
+    // Obrázek, jehož dlaždice se dekódují až podle viditelné části
+    void setTiledImage(std::shared_ptr<const TiledImageStore> store);
+    // Obrázek, který se teprve načítá - zobrazí se jen prvních 'readyRows' řádků
+    void setPartialImage(const QImage& partialImage, int readyRows);
 
     // Nové metody pro zoom
     void setZoomFactor(double factor);
@@ -20,13 +32,35 @@ public:
     void zoomOut();
     void resetZoom();
 
+signals:
+    // Zdrojový soubor obrázku po dlaždicích se změnil - dlaždice už nelze dekódovat
+    void sourceLost();
+
 protected:
     void paintEvent(QPaintEvent* event) override;
     void wheelEvent(QWheelEvent* event) override; // Pro zoom kolečkem myši
 
 private:
-    QImage image;
+    QImage image;       // 32bitová kopie zobrazeného obrázku
     double zoomFactor;  // Přidána proměnná pro zoom
+    std::shared_ptr<const MipPyramid> pyramid;
+    std::shared_ptr<const TiledImageStore> tiles;
+    bool refreshScheduled;  // Čeká se na dopočítání úrovní pyramidy
+    int loadedRows;         // Počet hotových řádků při načítání (-1 = celý obrázek)
+    bool sourceLostReported;
+
+    // Naposledy vykreslená viditelná část zvětšeného obrázku; překreslení
+    // se stejným zoomem a výřezem ji jen znovu vykreslí
+    QImage viewportCache;
+    QRect cachedViewport;     // Výřez v souřadnicích zvětšeného obrázku
+    double cachedZoom;
+    qint64 cachedSourceKey;   // QImage::cacheKey() vykreslené úrovně
+
+    void renderViewport(const QRect& viewport, const QImage& source, double sourceZoom);
+    void renderTiledViewport(const QRect& viewport);
+    void gather(const QImage& source, QPoint origin, const QVector<int>& columns, const QVector<int>& rows,
+                int availableRows = INT_MAX);
+    static QVector<int> sourceIndices(int first, int count, int sourceSize, double zoom);
 };
 
 #endif // CUSTOMIMAGEWIDGET_H
\ No newline at end of file
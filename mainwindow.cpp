@@ -8,16 +8,44 @@
 #include <QMenuBar>
 #include <QAction>
 #include <QFileDialog>
+#include <QDir>
 #include <QPainter>
+#include <QSaveFile>
 
 
 #include "styles.h"
+#include "TiledImageStore.h"
 #include "Filters/FlipFilter.h"
 #include "Filters/InvertFilter.h"
 #include "Filters/RotateFilter.h"
+#include "RleCodec.h"
+
+namespace {
+
+// Kopie souboru po blocích přes QSaveFile - cílový soubor se nahradí, až je
+// kopie celá; nepovedená nebo zrušená kopie ho nechá netknutý
+bool copyFileAtomically(const QString &source, const QString &target, const JobControl &control) {
+    const qint64 BlockBytes = 4 * 1024 * 1024;
+    QFile input(source);
+    QSaveFile output(target);
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    control.beginProgress(input.size() / BlockBytes + 1);
+    while (!input.atEnd()) {
+        const QByteArray block = input.read(BlockBytes);
+        if (block.isEmpty() || control.isCanceled() || output.write(block) != block.size()) {
+            return false;
+        }
+        control.addProgress(1);
+    }
+    return output.commit();
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
-        : QMainWindow(parent)
+        : QMainWindow(parent), showingPreview(false), showingProbeInfo(false), savingImage(false)
 {
     setWindowTitle("Image Editor");
     setGeometry(100, 100, 950, 600);
@@ -44,11 +72,22 @@ MainWindow::MainWindow(QWidget *parent)
         button->setStyleSheet(Styles::ButtonStyle);  // Aplikace stylu na tlačítko
         buttonLayout->addWidget(button);
 
+        filterButtons.push_back(button);
+
         connect(button, &QPushButton::clicked, [this, &filter]() {
-            if (currentImage.isEmpty()) return;
-            currentImage.applyFilter(*filter);
-            updateUI();
-});
+            if (currentImage.isEmpty() || imageJob->isRunning()) return;
+            const Filter *selected = filter.get();
+            // Filtr se provede nad kopií obrázku, widget zatím ukazuje původní stav
+            imageJob->start(selected->name(), currentImage,
+                [selected](Image &image, const JobControl &control) {
+                    return image.applyFilter(*selected, control);
+                },
+                [this](bool succeeded, Image &image) {
+                    if (!succeeded) return;
+                    currentImage = image;
+                    updateUI();
+                });
+        });
     }
 
     // Nastavení vlastností layoutu pro zarovnání tlačítek
@@ -63,6 +102,42 @@ MainWindow::MainWindow(QWidget *parent)
     imageWidget = new CustomImageWidget(this);
     leftLayout->addWidget(imageWidget, 1);  // 1 = stretch faktor pro zvětšení
 
+    // Průběh běžící operace a tlačítko pro její zrušení (viditelné jen při práci)
+    imageJob = new ImageJob(this);
+    QHBoxLayout *progressLayout = new QHBoxLayout();
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, 100);
+    cancelButton = new QPushButton(tr("Zrušit"), this);
+    cancelButton->setStyleSheet(Styles::ButtonStyle);
+    progressLayout->addWidget(progressBar, 1);
+    progressLayout->addWidget(cancelButton);
+    leftLayout->addLayout(progressLayout);
+
+    connect(cancelButton, &QPushButton::clicked, imageJob, &ImageJob::cancel);
+    connect(imageJob, &ImageJob::progressChanged, progressBar, &QProgressBar::setValue);
+    connect(imageJob, &ImageJob::started, [this](const QString &description) {
+        progressBar->setFormat(description + " %p%");
+        progressBar->setValue(0);
+        setBusy(true);
+    });
+    connect(imageJob, &ImageJob::previewChanged, this, &MainWindow::showPreview);
+    // Soubor otevřený po dlaždicích se na disku změnil - obrázek se zavře
+    // (mimo vykreslování, odkud widget změnu hlásí)
+    connect(imageWidget, &CustomImageWidget::sourceLost, this, [this]() {
+        if (!currentImage.isTiled() || !currentImage.tiles()->isSourceLost()) return;
+        currentImage = Image();
+        filePath.clear();
+        imageWidget->setImage(QImage());
+        updateImageInfo();
+        updateUI();
+        QMessageBox::warning(this, tr("Error"), tr("Soubor byl změněn jiným programem, obrázek je potřeba otevřít znovu!"));
+    }, Qt::QueuedConnection);
+    connect(imageJob, &ImageJob::finished, [this]() { setBusy(false); });
+    connect(imageJob, &ImageJob::canceled, [this]() {
+        setBusy(false);
+        restoreDisplay();
+    });
+
     // Přidání levé části do hlavního layoutu
     mainLayout->addLayout(leftLayout, 3);  // 3 = 75% šířky
 
@@ -118,11 +193,49 @@ MainWindow::MainWindow(QWidget *parent)
     // Přidání pravé části do hlavního layoutu
     mainLayout->addLayout(rightLayout, 1);  // 1 = 25% šířky
 
+    // Spodní panel se zmenšeninami souborů otevřené složky
+    thumbnailModel = new ThumbnailModel(this);
+    thumbnailView = new QListView(this);
+    thumbnailView->setModel(thumbnailModel);
+    thumbnailView->setViewMode(QListView::IconMode);
+    thumbnailView->setFlow(QListView::LeftToRight);
+    thumbnailView->setWrapping(false);
+    thumbnailView->setMovement(QListView::Static);
+    thumbnailView->setResizeMode(QListView::Adjust);
+    // Stejně velké položky a rozvržení po dávkách - i složka s tisíci
+    // soubory se zobrazí hned a posouvá se plynule
+    thumbnailView->setUniformItemSizes(true);
+    thumbnailView->setLayoutMode(QListView::Batched);
+    thumbnailView->setBatchSize(256);
+    thumbnailView->setIconSize(QSize(thumbnailModel->thumbnailSize(), thumbnailModel->thumbnailSize()));
+    thumbnailView->setGridSize(QSize(thumbnailModel->thumbnailSize() + 24, thumbnailModel->thumbnailSize() + 28));
+    thumbnailView->setMinimumHeight(thumbnailModel->thumbnailSize() + 48);
+
+    folderDock = new QDockWidget(tr("Složka"), this);
+    folderDock->setObjectName("folderDock");
+    folderDock->setAllowedAreas(Qt::TopDockWidgetArea | Qt::BottomDockWidgetArea);
+    folderDock->setWidget(thumbnailView);
+    addDockWidget(Qt::BottomDockWidgetArea, folderDock);
+    folderDock->hide();
+
+    connect(thumbnailView, &QListView::clicked, [this](const QModelIndex &index) {
+        const QString fileName = thumbnailModel->filePath(index);
+        if (!fileName.isEmpty()) {
+            openFile(fileName);
+        }
+    });
+
     // Vytvoření menu
     createMenuBar();
+    setBusy(false);
 }
 
-MainWindow::~MainWindow() = default;
+MainWindow::~MainWindow() {
+    // Běžící úloha se zruší a počká se na pracovní vlákno dřív, než zaniknou
+    // členské proměnné (filtr, se kterým úloha pracuje, patří do 'filters')
+    delete imageJob;
+    imageJob = nullptr;
+}
 
 void MainWindow::createMenuBar() {
     // Vytvoření hlavní menu lišty
@@ -134,40 +247,117 @@ void MainWindow::createMenuBar() {
 
     // Vytvoření akcí pro menu
     QAction *openAction = new QAction(tr("Otevřít"), this);
-    QAction *saveAction = new QAction(tr("Uložit"), this);
+    QAction *openFolderAction = new QAction(tr("Otevřít složku..."), this);
+    saveAction = new QAction(tr("Uložit"), this);
     QAction *exitAction = new QAction(tr("Zavřít aplikaci"), this);
+    rleAction = new QAction(tr("Ukládat s kompresí RLE"), this);
+    rleAction->setCheckable(true);
+    rleAction->setEnabled(false);
 
     // Přidání klávesových zkratek
     openAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_O));
+    openFolderAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_O));
     saveAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_S));
 
     // Přidání tooltipů
     openAction->setToolTip(tr("Otevřít obrázek (Ctrl+O)"));
+    openFolderAction->setToolTip(tr("Procházet obrázky ve složce (Ctrl+Shift+O)"));
     saveAction->setToolTip(tr("Uložit obrázek (Ctrl+S)"));
     exitAction->setToolTip(tr("Zavřít aplikaci"));
+    rleAction->setToolTip(tr("Uložit jako BI_RLE8/BI_RLE4, pokud vyjde menší (jen 4 a 8 bitů na pixel)"));
 
     // Připojení akcí na sloty
     connect(openAction, &QAction::triggered, this, &MainWindow::openImage);
+    connect(openFolderAction, &QAction::triggered, this, &MainWindow::openFolder);
     connect(saveAction, &QAction::triggered, this, &MainWindow::saveImage);
     connect(exitAction, &QAction::triggered, this, &MainWindow::close);
+    connect(rleAction, &QAction::triggered, this, [this](bool checked) {
+        currentImage.setSaveCompression(checked ? Image::Compression::RleIfSmaller : Image::Compression::None);
+    });
 
     // Přidání akcí do menu
     fileMenu->addAction(openAction);
+    fileMenu->addAction(openFolderAction);
     fileMenu->addAction(saveAction);
+    fileMenu->addAction(rleAction);
     fileMenu->addSeparator();
+#ifdef BMPEDITOR_ENABLE_TRACING
+    // Záznam časování pro chrome://tracing nebo Perfetto
+    QAction *traceAction = new QAction(tr("Exportovat časování..."), this);
+    connect(traceAction, &QAction::triggered, this, [this]() {
+        QString fileName = QFileDialog::getSaveFileName(this, tr("Export Trace"), "", tr("Chrome Trace (*.json)"));
+        if (!fileName.isEmpty() && !Trace::exportChromeTrace(fileName)) {
+            QMessageBox::warning(this, tr("Error"), tr("Nelze uložit soubor!"));
+        }
+    });
+    fileMenu->addAction(traceAction);
+    fileMenu->addSeparator();
+#endif
     fileMenu->addAction(exitAction);
+
+    // Menu "Úpravy" - historie úprav obrázku
+    QMenu *editMenu = menuBar->addMenu(tr("Úpravy"));
+    undoAction = new QAction(tr("Zpět"), this);
+    redoAction = new QAction(tr("Znovu"), this);
+    undoAction->setShortcut(QKeySequence::Undo);
+    redoAction->setShortcut(QKeySequence::Redo);
+    undoAction->setEnabled(false);
+    redoAction->setEnabled(false);
+    connect(undoAction, &QAction::triggered, this, &MainWindow::undo);
+    connect(redoAction, &QAction::triggered, this, &MainWindow::redo);
+    editMenu->addAction(undoAction);
+    editMenu->addAction(redoAction);
 }
 
 void MainWindow::openImage() {
     QString fileName = QFileDialog::getOpenFileName(this, tr("Open Image"), "", tr("Images (*.bmp)"));
     if (fileName.isEmpty()) return;
+    openFile(fileName);
+}
 
-    if (currentImage.loadFromFile(fileName)) {
-        filePath = fileName;
-        updateUI();
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("Nelze otevřít soubor!"));
+void MainWindow::openFolder() {
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Open Folder"), thumbnailModel->folder());
+    if (directory.isEmpty()) return;
+
+    thumbnailModel->setFolder(directory);
+    folderDock->setWindowTitle(tr("Složka") + " - " + QDir::toNativeSeparators(thumbnailModel->folder()));
+    folderDock->show();
+}
+
+void MainWindow::openFile(const QString &fileName) {
+    // Otevření jiného souboru by rozepsané uložení zrušilo a soubor by se
+    // tiše nezapsal - během ukládání se proto nic neotevírá
+    if (savingImage) {
+        QMessageBox::information(this, tr("Ukládání"),
+            tr("Obrázek se právě ukládá. Jiný soubor lze otevřít až po dokončení uložení."));
+        return;
     }
+
+    // Velké soubory se dekódují až po dlaždicích podle toho, co je vidět
+    const Image::LoadMode mode = QFileInfo(fileName).size() > TiledLoadThreshold
+                                 ? Image::LoadMode::Tiled : Image::LoadMode::Mapped;
+
+    // Hlavičky a paleta se zobrazí hned - pixely se teprve načítají
+    const Image::ProbeInfo probe = Image::probe(fileName);
+    if (probe.valid) {
+        showProbeInfo(fileName, probe);
+    }
+
+    // Případná běžící operace se zruší, dosavadní obrázek zůstává zobrazený
+    imageJob->start(tr("Načítání"), Image(),
+        [fileName, mode](Image &image, const JobControl &control) {
+            return image.loadFromFile(fileName, mode, control);
+        },
+        [this, fileName](bool succeeded, Image &image) {
+            if (succeeded) {
+                currentImage = image;
+                filePath = fileName;
+                updateUI();
+            } else {
+                restoreDisplay();
+                QMessageBox::warning(this, tr("Error"), tr("Nelze otevřít soubor!"));
+            }
+        });
 }
 
 void MainWindow::saveImage() {
@@ -175,14 +365,20 @@ void MainWindow::saveImage() {
         QMessageBox::warning(this, tr("Error"), tr("No image to save!"));
         return;
     }
+    if (imageJob->isRunning()) return;
 
     QString fileName = QFileDialog::getSaveFileName(this, tr("Save Image"), "", tr("Images (*.bmp)"));
     if (fileName.isEmpty()) return;
 
     bool useCopyMethod = false;
 
-    // Pokud obrázek nebyl modifikován, nabídneme možnost prostého kopírování
-    if (!currentImage.isModified()) {
+    // Pokud obrázek nebyl modifikován (a ukládá se se stejnou kompresí jako
+    // zdrojový soubor), nabídneme možnost prostého kopírování
+    const int bitsPerPixel = currentImage.bitsPerPixel();
+    const bool sourceRle = RleCodec::isRle(currentImage.getInfoHeader().biCompression);
+    const bool saveRle = currentImage.saveCompression() == Image::Compression::RleIfSmaller &&
+                         RleCodec::compressionFor(bitsPerPixel) != 0;
+    if (!currentImage.isModified() && !filePath.isEmpty() && sourceRle == saveRle) {
         QMessageBox::StandardButton reply;
         reply = QMessageBox::question(this, tr("Způsob uložení"),
             tr("Obrázek nebyl modifikován. Chcete jej uložit kopírováním původního souboru?\n\n"
@@ -192,38 +388,142 @@ void MainWindow::saveImage() {
 
         useCopyMethod = (reply == QMessageBox::Yes);
 
-        if (useCopyMethod) {
-            std::cout << "File not modified, Copying image to: " << fileName.toStdString() << std::endl;
-            if (QFile::exists(fileName)) {
-                QFile::remove(fileName);  // Odstraní existující soubor se stejným názvem
-            }
+        if (useCopyMethod && QFileInfo(fileName).canonicalFilePath() == QFileInfo(filePath).canonicalFilePath()) {
+            return;  // Cílem je původní soubor - není co kopírovat
+        }
+    }
 
-            if (QFile::copy(filePath, fileName)) {
-                return;  // Úspěšné kopírování
+    // Uložení běží v pracovním vlákně - kopie původního souboru (když selže,
+    // data se vygenerují znovu), nebo metoda třídy Image
+    ImageJob::Work work;
+    if (useCopyMethod) {
+        const QString sourcePath = filePath;
+        std::cout << "File not modified, Copying image to: " << fileName.toStdString() << std::endl;
+        work = [sourcePath, fileName](Image &image, const JobControl &control) {
+            if (copyFileAtomically(sourcePath, fileName, control)) {
+                return true;
+            }
+            if (control.isCanceled()) {
+                return false;
             }
-            // Pokud kopírování selže, přejdeme k alternativní metodě
             std::cout << "Copy failed, using manual data generation instead" << std::endl;
-        }
+            return image.saveToFile(fileName, control);
+        };
+    } else {
+        work = [fileName](Image &image, const JobControl &control) {
+            return image.saveToFile(fileName, control);
+        };
+    }
+
+    savingImage = true;
+    imageJob->start(tr("Ukládání"), currentImage, work,
+        [this, fileName](bool succeeded, Image &image) {
+            // Na Windows uložení přes zdrojový soubor uvolní jeho mapování - stav se převezme
+            currentImage = image;
+            if (succeeded) {
+                std::cout << "Image saved successfully to: " << fileName.toStdString() << std::endl;
+            } else {
+                QMessageBox::warning(this, tr("Error"), tr("Failed to save the image!"));
+            }
+        });
+}
+
+void MainWindow::undo() {
+    if (!currentImage.canUndo() || imageJob->isRunning()) return;
+    // Krok s inverzí se provede jako filtr, snímek se rozbalí - obojí v pracovním vlákně
+    imageJob->start(tr("Zpět"), currentImage,
+        [](Image &image, const JobControl &control) {
+            return image.undo(control);
+        },
+        [this](bool succeeded, Image &image) {
+            if (!succeeded) return;
+            currentImage = image;
+            updateUI();
+        });
+}
+
+void MainWindow::redo() {
+    if (!currentImage.canRedo() || imageJob->isRunning()) return;
+    imageJob->start(tr("Znovu"), currentImage,
+        [](Image &image, const JobControl &control) {
+            return image.redo(control);
+        },
+        [this](bool succeeded, Image &image) {
+            if (!succeeded) return;
+            currentImage = image;
+            updateUI();
+        });
+}
+
+void MainWindow::updateHistoryActions(bool busy) {
+    undoAction->setEnabled(!busy && currentImage.canUndo());
+    redoAction->setEnabled(!busy && currentImage.canRedo());
+    undoAction->setText(currentImage.canUndo() ? tr("Zpět: %1").arg(currentImage.undoName()) : tr("Zpět"));
+    redoAction->setText(currentImage.canRedo() ? tr("Znovu: %1").arg(currentImage.redoName()) : tr("Znovu"));
+}
+
+void MainWindow::setBusy(bool busy) {
+    // Během operace lze jen zrušit, nebo načíst jiný soubor (ne při ukládání)
+    for (QPushButton *button : filterButtons) {
+        button->setEnabled(!busy);
+    }
+    saveAction->setEnabled(!busy);
+    updateHistoryActions(busy);
+    if (!busy) {
+        savingImage = false;  // Ukládání skončilo nebo bylo zrušeno
     }
+    progressBar->setVisible(busy);
+    cancelButton->setVisible(busy);
+}
 
-    // Použití metody třídy Image pro uložení souboru
-    if (currentImage.saveToFile(fileName)) {
-        std::cout << "Image saved successfully to: " << fileName.toStdString() << std::endl;
+void MainWindow::showPreview(const QImage &preview, int readyRows) {
+    // Při prvním náhledu nového souboru se zoom vrátí na výchozí hodnotu
+    if (!showingPreview) {
+        imageWidget->resetZoom();
+        showingPreview = true;
+    }
+    imageWidget->setPartialImage(preview, readyRows);
+}
+
+void MainWindow::restoreDisplay() {
+    // Načítání nedoběhlo - zobrazí se zpět poslední hotový obrázek
+    if (showingProbeInfo) {
+        showingProbeInfo = false;
+        updateImageInfo();
+    }
+    if (!showingPreview) return;
+    showingPreview = false;
+    if (currentImage.isEmpty()) {
+        imageWidget->setImage(QImage());
     } else {
-        QMessageBox::warning(this, tr("Error"), tr("Failed to save the image!"));
+        updateUI();
     }
 }
 
 void MainWindow::updateUI() {
+    showingPreview = false;
     if (!currentImage.isEmpty()) {
         imageWidget->resetZoom();
-        imageWidget->setImage(currentImage.toQImage());
+        if (currentImage.isTiled()) {
+            imageWidget->setTiledImage(currentImage.tiles());
+        } else {
+            imageWidget->setImage(currentImage.toQImage(), currentImage.pyramid());
+        }
         updateImageInfo();
     }
+    // Nastavení komprese patří k obrázku (po načtení podle zdrojového souboru)
+    const int bitsPerPixel = currentImage.bitsPerPixel();
+    rleAction->setEnabled(bitsPerPixel == 4 || bitsPerPixel == 8);
+    rleAction->setChecked(currentImage.saveCompression() == Image::Compression::RleIfSmaller);
+    updateHistoryActions(imageJob->isRunning());
 }
 
 void MainWindow::updateImageInfo() {
-    if (filePath.isEmpty() || currentImage.isEmpty()) return;
+    showingProbeInfo = false;
+    if (filePath.isEmpty() || currentImage.isEmpty()) {
+        infoTextEdit->clear();
+        return;
+    }
 
     QFileInfo fileInfo(filePath);
     infoTextEdit->clear();
@@ -234,10 +534,50 @@ void MainWindow::updateImageInfo() {
     infoTextEdit->append("Size: " + QString::number(fileInfo.size()) + " bytes");
     infoTextEdit->append("Format: " + QString::number(currentImage.bitsPerPixel()) + "-bit BMP");
 
+    // Paměť v okamžiku zobrazení (zmenšeniny a dlaždice mohou ještě přibývat)
+    const Image::MemoryUsage memory = currentImage.memoryUsage();
+    infoTextEdit->append("Memory: " + QString::number(memory.total()) + " bytes");
+    infoTextEdit->append(QString("  pixels %1, raw %2, pyramid %3, tiles %4")
+        .arg(memory.pixels).arg(memory.rawData).arg(memory.pyramid).arg(memory.tiles));
+    if (memory.mapped > 0) {
+        infoTextEdit->append("Mapped: " + QString::number(memory.mapped) + " bytes");
+    }
+
     // Získání BMP header dat z objektu Image
-    const Image::BMPFileHeader& bmpFileHeader = currentImage.getFileHeader();
-    const Image::BMPInfoHeader& bmpInfoHeader = currentImage.getInfoHeader();
+    appendHeaderInfo(currentImage.getFileHeader(), currentImage.getInfoHeader());
+
+#ifdef BMPEDITOR_ENABLE_TRACING
+    appendTimingInfo();
+#endif
 
+    // Pro obrázky s paletou vypíšeme informace o paletě
+    if (currentImage.bitsPerPixel() <= 8) {
+        appendPaletteInfo(currentImage.palette());
+    }
+}
+
+void MainWindow::showProbeInfo(const QString &fileName, const Image::ProbeInfo &probe) {
+    // Jen hlavičky (Image::probe) - rozměry a formát bez dekódování pixelů
+    showingProbeInfo = true;
+    infoTextEdit->clear();
+    infoTextEdit->append("Image Info (loading):");
+    infoTextEdit->append("File Path: " + fileName);
+    infoTextEdit->append("Width: " + QString::number(probe.width()));
+    infoTextEdit->append("Height: " + QString::number(probe.height()));
+    infoTextEdit->append("Size: " + QString::number(probe.fileSize) + " bytes");
+    infoTextEdit->append("Format: " + QString::number(probe.bitsPerPixel()) + "-bit BMP");
+    if (!probe.supported) {
+        infoTextEdit->append("Unsupported format");
+    }
+
+    appendHeaderInfo(probe.fileHeader, probe.infoHeader);
+    if (probe.bitsPerPixel() <= 8) {
+        appendPaletteInfo(probe.palette);
+    }
+}
+
+void MainWindow::appendHeaderInfo(const Image::BMPFileHeader &bmpFileHeader,
+                                  const Image::BMPInfoHeader &bmpInfoHeader) {
     infoTextEdit->append("\nBMP File Header:");
     infoTextEdit->append("bfType: " + QString(bmpFileHeader.bfType[0]) + QString(bmpFileHeader.bfType[1]));
     infoTextEdit->append("bfSize: " + QString::number(bmpFileHeader.bfSize) + " bytes");
@@ -259,35 +599,64 @@ void MainWindow::updateImageInfo() {
         case 1: compressionType = "BI_RLE8 (1) - 8-bit RLE komprese"; break;
         case 2: compressionType = "BI_RLE4 (2) - 4-bit RLE komprese"; break;
         case 3: compressionType = "BI_BITFIELDS (3) - bitové masky"; break;
+        case 6: compressionType = "BI_ALPHABITFIELDS (6) - bitové masky s alfou"; break;
         default: compressionType = QString::number(bmpInfoHeader.biCompression) + " - neznámý typ"; break;
     }
     infoTextEdit->append("biCompression: " + compressionType);
 
+    // Masky kanálů 16/32bitových obrázků (u BI_RGB výchozí)
+    if (bmpInfoHeader.biBitCount == 16 || bmpInfoHeader.biBitCount == 32) {
+        const BitFields masks = Image::channelMasks(bmpInfoHeader);
+        infoTextEdit->append(QString("Channel Masks: R=0x%1 G=0x%2 B=0x%3 A=0x%4")
+            .arg(masks.red, 8, 16, QChar('0'))
+            .arg(masks.green, 8, 16, QChar('0'))
+            .arg(masks.blue, 8, 16, QChar('0'))
+            .arg(masks.alpha, 8, 16, QChar('0')));
+    }
+
     infoTextEdit->append("biSizeImage: " + QString::number(bmpInfoHeader.biSizeImage) + " bytes");
     infoTextEdit->append("biXPelsPerMeter: " + QString::number(bmpInfoHeader.biXPelsPerMeter));
     infoTextEdit->append("biYPelsPerMeter: " + QString::number(bmpInfoHeader.biYPelsPerMeter));
     infoTextEdit->append("biClrUsed: " + QString::number(bmpInfoHeader.biClrUsed));
     infoTextEdit->append("biClrImportant: " + QString::number(bmpInfoHeader.biClrImportant));
+}
 
-    // Pro obrázky s paletou vypíšeme informace o paletě
-    if (currentImage.bitsPerPixel() <= 8) {
-        const QVector<QRgb>& palette = currentImage.palette();
-
-        infoTextEdit->append("\nPalette Info:");
-        infoTextEdit->append("Palette Size: " + QString::number(palette.size()) + " colors");
-
-        // Pro menší palety můžeme vypsat i barvy
-        if (palette.size() <= 256) {
-            infoTextEdit->append("\nPalette Colors (RGB):");
-            for (int i = 0; i < palette.size(); i++) {
-                QRgb color = palette[i];
-                QString colorStr = QString("Color %1: R=%2, G=%3, B=%4")
-                    .arg(i, 2, 10, QChar('0'))
-                    .arg(qRed(color), 3, 10, QChar('0'))
-                    .arg(qGreen(color), 3, 10, QChar('0'))
-                    .arg(qBlue(color), 3, 10, QChar('0'));
-                infoTextEdit->append(colorStr);
-            }
+void MainWindow::appendPaletteInfo(const QVector<QRgb> &palette) {
+    infoTextEdit->append("\nPalette Info:");
+    infoTextEdit->append("Palette Size: " + QString::number(palette.size()) + " colors");
+
+    // Pro menší palety můžeme vypsat i barvy
+    if (palette.size() <= 256) {
+        infoTextEdit->append("\nPalette Colors (RGB):");
+        for (int i = 0; i < palette.size(); i++) {
+            QRgb color = palette[i];
+            QString colorStr = QString("Color %1: R=%2, G=%3, B=%4")
+                .arg(i, 2, 10, QChar('0'))
+                .arg(qRed(color), 3, 10, QChar('0'))
+                .arg(qGreen(color), 3, 10, QChar('0'))
+                .arg(qBlue(color), 3, 10, QChar('0'));
+            infoTextEdit->append(colorStr);
         }
     }
-}
\ No newline at end of file
+}
+
+#ifdef BMPEDITOR_ENABLE_TRACING
+void MainWindow::appendTimingInfo() {
+    // Souhrn posledních změřených úseků (kruhový buffer v Trace)
+    infoTextEdit->append("\nTiming (recent):");
+    for (const Trace::StageSummary &stage : Trace::summarize()) {
+        QString line = QString("%1: last %2 ms, avg %3 ms, max %4 ms (%5x)")
+            .arg(stage.name)
+            .arg(stage.lastNs / 1e6, 0, 'f', 2)
+            .arg(stage.averageNs / 1e6, 0, 'f', 2)
+            .arg(stage.maxNs / 1e6, 0, 'f', 2)
+            .arg(stage.count);
+        if (stage.bytes > 0) {
+            line += QString(", alloc %1 MB").arg(stage.bytes / (1024.0 * 1024.0), 0, 'f', 1);
+        }
+        infoTextEdit->append(line);
+    }
+    infoTextEdit->append(QString("Allocated total: %1 MB")
+                             .arg(Trace::totalAllocatedBytes() / (1024.0 * 1024.0), 0, 'f', 1));
+}
+#endif
@@ -5,6 +5,7 @@
 #include <QImage>
 #include <QLabel>
 #include <QPushButton>
+#include <QProgressBar>
 #include <QTextEdit>
 #include <QFileDialog>
 #include <QVBoxLayout>
@@ -12,11 +13,16 @@
 #include <QFileInfo>
 #include <QWidget>
 #include <QPaintEvent>
+#include <QDockWidget>
+#include <QListView>
 #include <vector>
 
 #include "customimagewidget.h"
 #include "Filters/Filter.h"
 #include "Image.h"
+#include "ImageJob.h"
+#include "ThumbnailModel.h"
+#include "Trace.h"
 
 class MainWindow : public QMainWindow
 {
@@ -28,18 +34,53 @@ public:
 
     private slots:
         void openImage();
+        void openFolder();
         void saveImage();
+        void undo();
+        void redo();
         void updateUI();
+        void setBusy(bool busy);
+        void showPreview(const QImage &preview, int readyRows);
 
 private:
+    // Soubory větší než tato mez se načítají po dlaždicích
+    static const qint64 TiledLoadThreshold = 64 * 1024 * 1024;
+
     CustomImageWidget *imageWidget;
     QTextEdit *infoTextEdit;
     Image currentImage;
     QString filePath;
     std::vector<std::unique_ptr<Filter>> filters;
+    std::vector<QPushButton*> filterButtons;
+
+    // Načítání, filtry a ukládání běží v pracovním vlákně
+    ImageJob *imageJob;
+    // Zmenšeniny souborů otevřené složky (panel je skrytý, dokud se složka neotevře)
+    ThumbnailModel *thumbnailModel;
+    QListView *thumbnailView;
+    QDockWidget *folderDock;
+    QProgressBar *progressBar;
+    QPushButton *cancelButton;
+    QAction *saveAction;
+    QAction *rleAction;
+    QAction *undoAction;
+    QAction *redoAction;
+    bool showingPreview;  // Widget ukazuje rozpracovaný (načítaný) obrázek
+    bool showingProbeInfo;  // Panel informací ukazuje hlavičky načítaného souboru
+    bool savingImage;  // Běžící úloha zapisuje soubor - nesmí se zrušit otevřením jiného
+
+    void openFile(const QString &fileName);
+    void restoreDisplay();
+    void updateHistoryActions(bool busy);
 
     void createMenuBar();
     void updateImageInfo();
+    void showProbeInfo(const QString &fileName, const Image::ProbeInfo &probe);
+    void appendHeaderInfo(const Image::BMPFileHeader &bmpFileHeader, const Image::BMPInfoHeader &bmpInfoHeader);
+    void appendPaletteInfo(const QVector<QRgb> &palette);
+#ifdef BMPEDITOR_ENABLE_TRACING
+    void appendTimingInfo();
+#endif
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file